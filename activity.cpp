@@ -0,0 +1,124 @@
+#include "activity.hpp"
+#include "exec.hpp"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace {
+
+constexpr int kGroups = 4;   // rho, velocity, pressure, field
+
+struct Tracked { const Grid* g; int group; };
+
+std::vector<Tracked> tracked(const FlowField& f){
+    return {
+        {&f.rho, 0}, {&f.u, 1}, {&f.v, 1}, {&f.p, 2}, {&f.bx, 3}, {&f.by, 3}, {&f.psi, 3},
+#ifdef MHD_2P5D
+        {&f.w, 1}, {&f.bz, 3},
+#endif
+    };
+}
+
+} // namespace
+
+void ActivityMask::begin(const FlowField& flow, int tile, double tol){
+    const int nx = flow.rho.nx, ny = flow.rho.ny;
+    tile = std::max(tile, 1);
+    if (nx != nx_ || ny != ny_ || tile != tile_) {
+        // New grid: every tile starts active, with no stored fluxes
+        nx_ = nx; ny_ = ny; tile_ = tile;
+        ntx_ = (nx-2 + tile-1) / tile;
+        nty_ = (ny-2 + tile-1) / tile;
+        ti_.resize(nx);
+        tj_.resize(ny);
+        for (int i = 1; i < nx-1; ++i) ti_[i] = (i-1) / tile;
+        for (int j = 1; j < ny-1; ++j) tj_[j] = (j-1) / tile;
+        ti_[0] = ti_[nx-2]; ti_[nx-1] = ti_[1];
+        tj_[0] = tj_[ny-2]; tj_[ny-1] = tj_[1];
+        drift_.assign((size_t)ntx_*nty_, std::numeric_limits<double>::infinity());
+        fx.assign((size_t)nx*ny, HLLFlux{});
+        fy.assign((size_t)nx*ny, HLLFlux{});
+    }
+
+    // Active: the tile or a neighbour has drifted by tol or more
+    active_.assign((size_t)ntx_*nty_, 0);
+    needed_.assign((size_t)ntx_*nty_, 0);
+    auto neighbours = [&](int ti, int tj, auto&& f){
+        for (int a = -1; a <= 1; ++a)
+            for (int b = -1; b <= 1; ++b)
+                f((ti + a + ntx_) % ntx_, (tj + b + nty_) % nty_);
+    };
+    skipped_ = 0;
+    for (int ti = 0; ti < ntx_; ++ti)
+        for (int tj = 0; tj < nty_; ++tj) {
+            bool on = false;
+            neighbours(ti, tj, [&](int a, int b){ on = on || !(drift_[(size_t)a*nty_ + b] < tol); });
+            active_[(size_t)ti*nty_ + tj] = on;
+            if (!on) {
+                skipped_ += (long)(std::min(1 + (ti+1)*tile, nx-1) - (1 + ti*tile))
+                                * (std::min(1 + (tj+1)*tile, ny-1) - (1 + tj*tile));
+            }
+        }
+    for (int ti = 0; ti < ntx_; ++ti)
+        for (int tj = 0; tj < nty_; ++tj)
+            if (active_[(size_t)ti*nty_ + tj])
+                neighbours(ti, tj, [&](int a, int b){ needed_[(size_t)a*nty_ + b] = 1; });
+
+    std::vector<Tracked> t = tracked(flow);
+    prev_.resize(t.size());
+    for (size_t v = 0; v < t.size(); ++v) prev_[v] = t[v].g->data;
+}
+
+void ActivityMask::end(const FlowField& flow){
+    const std::vector<Tracked> t = tracked(flow);
+    const size_t ntiles = (size_t)ntx_*nty_;
+    std::vector<double> change(ntiles * kGroups, 0.0), scale(ntiles * kGroups, 0.0);
+
+    // Total pressure p + rho|u|^2/2 + |B|^2/2 of the state the step started from
+    const Array2D &rho = prev_[0], &u = prev_[1], &v = prev_[2], &p = prev_[3], &bx = prev_[4], &by = prev_[5];
+    auto total_pressure = [&](int i, int j){
+        double q = p[i][j] + 0.5*rho[i][j]*(u[i][j]*u[i][j] + v[i][j]*v[i][j])
+                 + 0.5*(bx[i][j]*bx[i][j] + by[i][j]*by[i][j]);
+#ifdef MHD_2P5D
+        const Array2D &w = prev_[7], &bz = prev_[8];
+        q += 0.5*rho[i][j]*w[i][j]*w[i][j] + 0.5*bz[i][j]*bz[i][j];
+#endif
+        return q;
+    };
+
+    // Largest change per tile and group, and each group's scale in the tile:
+    // its largest magnitude, but at least the magnitude that total pressure
+    // gives it (velocity sqrt(2q/rho), pressure q, field sqrt(2q))
+    exec::for_2d(0, ntx_, 0, nty_, [&](int ti, int tj) {
+        double* c = &change[((size_t)ti*nty_ + tj) * kGroups];
+        double* a = &scale[((size_t)ti*nty_ + tj) * kGroups];
+        const int i1 = std::min(1 + (ti+1)*tile_, nx_-1), j1 = std::min(1 + (tj+1)*tile_, ny_-1);
+        for (size_t k = 0; k < t.size(); ++k) {
+            const Array2D& now = t[k].g->data;
+            const Array2D& old = prev_[k];
+            const int g = t[k].group;
+            for (int i = 1 + ti*tile_; i < i1; ++i)
+                for (int j = 1 + tj*tile_; j < j1; ++j) {
+                    c[g] = std::max(c[g], std::abs(now[i][j] - old[i][j]));
+                    a[g] = std::max(a[g], std::abs(old[i][j]));
+                }
+        }
+        for (int i = 1 + ti*tile_; i < i1; ++i)
+            for (int j = 1 + tj*tile_; j < j1; ++j) {
+                const double q = std::max(total_pressure(i, j), 0.0);
+                a[1] = std::max(a[1], std::sqrt(2.0*q/rho[i][j]));
+                a[2] = std::max(a[2], q);
+                a[3] = std::max(a[3], std::sqrt(2.0*q));
+            }
+    });
+
+    // A tile that was active restarts its drift from the fluxes it just computed
+    for (size_t k = 0; k < ntiles; ++k) {
+        double d = 0.0;
+        for (int g = 0; g < kGroups; ++g) {
+            const double c = change[k*kGroups + g], a = scale[k*kGroups + g];
+            if (c > 0.0) d = std::max(d, a > 0.0 ? c / a : std::numeric_limits<double>::infinity());
+        }
+        drift_[k] = active_[k] ? d : drift_[k] + d;
+    }
+}
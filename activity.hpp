@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include "riemann.hpp"
+
+// Tile activity mask for the global-dt update. The interior is split into
+// opts.activity_tile^2 tiles. A tile whose primitive state, and that of its
+// eight (periodic) neighbours, has drifted by less than opts.activity_tol
+// since its face fluxes were last computed keeps those fluxes: the slopes and
+// HLL solves of its faces are skipped, and its cells are advanced with the
+// stored fluxes. Faces shared with an active tile are always recomputed, so
+// the update stays conservative. A tile wakes up as soon as its own or a
+// neighbour's accumulated drift reaches the tolerance, which bounds the
+// change in the flux inputs since the fluxes were computed.
+//
+// Drift is the largest change per step relative to each field group's scale
+// in the tile itself: the maximum of |rho|, of |u|, |v| (and |w|), of |p|,
+// and of |Bx|, |By| (|Bz|) and |psi| over the tile's cells. The scales of
+// velocity, pressure and field are floored by what the total pressure
+// q = p + rho|u|^2/2 + |B|^2/2 gives them (sqrt(2q/rho), q and sqrt(2q)),
+// so a cold or weakly magnetised tile is not woken by changes too small to
+// matter for its fluxes, and a tile is never judged against another
+// region's larger values.
+struct ActivityMask {
+    // Decide the active tiles for the coming step and keep a copy of the state
+    void begin(const FlowField& flow, int tile, double tol);
+    // Measure this step's change per tile
+    void end(const FlowField& flow);
+
+    // Face fluxes of the last step, fx[i][j] at x-face i+1/2, row stride ny
+    std::vector<HLLFlux> fx, fy;
+
+    // Face (i+1/2, j) or (i, j+1/2) needs a fresh flux (at least one side active)
+    bool face_x(int i, int j) const { return on(ti_[i], tj_[j]) || on(ti_[i+1], tj_[j]); }
+    bool face_y(int i, int j) const { return on(ti_[i], tj_[j]) || on(ti_[i], tj_[j+1]); }
+
+    int tiles_x() const { return ntx_; }
+    int tiles_y() const { return nty_; }
+    // Tile (ti, tj) or one of its neighbours is active, so its slopes are needed
+    bool needed(int ti, int tj) const { return needed_[(size_t)ti*nty_ + tj]; }
+    // Cell rows [first, second) of tile ti, the ghost layer included in the edge tiles
+    std::pair<int, int> span_x(int ti) const { return span(ti, ntx_, nx_); }
+    std::pair<int, int> span_y(int tj) const { return span(tj, nty_, ny_); }
+
+    long skipped() const { return skipped_; }   // interior cells of the inactive tiles this step
+
+private:
+    bool on(int ti, int tj) const { return active_[(size_t)ti*nty_ + tj]; }
+    std::pair<int, int> span(int t, int nt, int n) const {
+        return {t == 0 ? 0 : 1 + t*tile_, t == nt-1 ? n : 1 + (t+1)*tile_};
+    }
+
+    int nx_ = 0, ny_ = 0, tile_ = 0, ntx_ = 0, nty_ = 0;
+    std::vector<int> ti_, tj_;        // tile of each cell index, ghosts mapped periodically
+    std::vector<char> active_, needed_;
+    std::vector<double> drift_;       // change since the tile's fluxes were computed
+    std::vector<Array2D> prev_;       // state at the start of the step
+    long skipped_ = 0;
+};
@@ -1,20 +1,18 @@
-"""Check mass and energy conservation from output CSV files."""
-import numpy as np, pandas as pd, matplotlib.pyplot as plt, glob, re
+"""Check mass and energy conservation from the solver output."""
+import numpy as np, matplotlib.pyplot as plt
+from snapshots import open_result
 
-rho_files = glob.glob("Result/out_rho_*.csv")
-if not rho_files:
+result = open_result("Result")
+if not result.steps:
     raise SystemExit("No output found")
-steps = sorted(int(re.findall(r"_rho_(\d+).csv",f)[0]) for f in rho_files)
+steps = result.steps
 
 # grid info
-sample = pd.read_csv(rho_files[0], header=None)
-xs = np.unique(sample[0]); ys = np.unique(sample[1])
+xs, ys = result.xs, result.ys
 DX = xs[1]-xs[0]; DY = ys[1]-ys[0]
-NX, NY = len(xs), len(ys)
 
 def load(step, prefix):
-    df = pd.read_csv(f"Result/out_{prefix}_{step}.csv", header=None)
-    return df[2].values.reshape(NX, NY).T
+    return result.read(step, prefix).T
 
 mass=[]; energy=[]
 for s in steps:
@@ -1,29 +1,24 @@
 """Analyse magnetic field divergence from simulation output.
 
-This script reads ``out_bx_*.csv`` and ``out_by_*.csv`` files located
-in ``Result/`` and computes both the L2 norm and the maximum absolute
+This script reads ``bx`` and ``by`` from the output in ``Result/``
+(snapshot container or CSV files) and computes both the L2 norm and the maximum absolute
 value of ``∇·B`` for each available time step.  Two subplots showing the
 evolution of these quantities are saved to ``Result/divB_error.png``.
 """
 
-import numpy as np, pandas as pd, matplotlib.pyplot as plt, re, os, glob
+import numpy as np, matplotlib.pyplot as plt
+from snapshots import open_result
 
-files = glob.glob("Result/out_bx_*.csv")
-if not files:
+result = open_result("Result")
+if not result.steps:
     raise RuntimeError("No B field output found. Did you recompile & rerun the solver?")
 
-steps = sorted(int(re.findall(r"_bx_(\d+).csv",f)[0]) for f in files)
+steps = result.steps
 
 def load(step,prefix):
-    d = pd.read_csv(f"Result/out_{prefix}_{step}.csv",header=None)
-    return d.values[:,2]
+    return result.read(step, prefix).ravel()
 
-def grid_shape():
-    df = pd.read_csv(files[0],header=None)
-    xs = np.unique(df[0]); ys = np.unique(df[1])
-    return len(xs), len(ys), xs, ys
-
-nx, ny, xs, ys = grid_shape()
+nx, ny, xs, ys = result.nx, result.ny, result.xs, result.ys
 dx = xs[1]-xs[0]; dy = ys[1]-ys[0]
 
 l2 = []
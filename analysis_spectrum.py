@@ -3,23 +3,18 @@
 Generates Result/energy_spectrum.png
 """
 
-import numpy as np, pandas as pd, matplotlib.pyplot as plt, glob, re, os
+import numpy as np, matplotlib.pyplot as plt
+from snapshots import open_result
 
-u_files = glob.glob("Result/out_u_*.csv")
-if not u_files:
+result = open_result("Result")
+if not result.steps:
     raise SystemExit("No velocity output found.")
 
-steps = sorted(int(re.findall(r"_u_(\d+).csv",f)[0]) for f in u_files)
-
-def grid():
-    df = pd.read_csv(u_files[0],header=None)
-    xs=np.unique(df[0]); ys=np.unique(df[1])
-    return len(xs), len(ys), xs, ys
-nx,ny,xs,ys = grid()
+steps = result.steps
+nx,ny,xs,ys = result.nx, result.ny, result.xs, result.ys
 
 def load(step,comp):
-    df = pd.read_csv(f"Result/out_{comp}_{step}.csv",header=None)
-    return df.values[:,2].reshape(nx,ny).T
+    return result.read(step, comp).T
 
 def spectrum(u,v):
     u = u - u.mean(); v = v - v.mean()
@@ -0,0 +1,187 @@
+#include "autotune.hpp"
+#include "activity.hpp"
+#include "riemann.hpp"
+#include "exec.hpp"
+#include <omp.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+bool uses_lts(const SolverOptions& opts){
+    return opts.lts_levels > 1 && opts.divb != DivBScheme::CT;
+}
+
+// Whether a FixedDims kernel exists for this grid, i.e. fixed_size matters
+bool has_fixed_kernel(const FlowField& flow){
+    return dispatch_dims(flow.rho.nx, flow.rho.ny, true, [](auto dims){
+        return !std::is_same_v<decltype(dims), RuntimeDims>;
+    });
+}
+
+std::string cpu_model(){
+    std::ifstream in("/proc/cpuinfo");
+    std::string line;
+    while(std::getline(in, line))
+        if(line.rfind("model name", 0) == 0 && line.find(':') != std::string::npos)
+            return line.substr(line.find(':') + 1);
+    return "unknown";
+}
+
+// The key is the first word of a cache line
+std::string one_word(std::string s){
+    s.erase(0, s.find_first_not_of(" \t"));
+    s.erase(s.find_last_not_of(" \t") + 1);
+    for(char& c : s)
+        if(c == ' ' || c == '\t' || c == '|') c = '_';
+    return s;
+}
+
+bool read_cache(const std::string& path, const std::string& key, TuneChoice& choice){
+    std::ifstream in(path);
+    std::string line;
+    while(std::getline(in, line)){
+        std::istringstream words(line);
+        std::string k;
+        if(!(words >> k) || k != key) continue;
+        int fixed = 1;
+        TuneChoice c;
+        if(std::sscanf(line.c_str() + k.size(), " threads=%d fixed_size=%d tile=%d ms=%lf",
+                       &c.threads, &fixed, &c.tile, &c.ms_per_step) == 4 && c.threads > 0){
+            c.fixed_size = fixed != 0;
+            choice = c;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Replaces the line of key, through a temporary file so readers never see a partial cache
+void write_cache(const std::string& path, const std::string& key, const TuneChoice& c){
+    namespace fs = std::filesystem;
+    std::vector<std::string> lines;
+    {
+        std::ifstream in(path);
+        std::string line, k;
+        while(std::getline(in, line)){
+            std::istringstream words(line);
+            if(!(words >> k) || k != key) lines.push_back(line);
+        }
+    }
+    if(lines.empty()) lines.push_back("# mhd_solver autotune cache: key threads fixed_size tile ms/step");
+    std::ostringstream entry;
+    entry << key << " threads=" << c.threads << " fixed_size=" << (c.fixed_size ? 1 : 0)
+          << " tile=" << c.tile << " ms=" << c.ms_per_step;
+    lines.push_back(entry.str());
+
+    std::error_code ec;
+    const fs::path target(path);
+    if(target.has_parent_path()) fs::create_directories(target.parent_path(), ec);
+    const std::string tmp = path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream out(tmp);
+        for(const std::string& l : lines) out << l << "\n";
+        if(!out.flush()) ec = std::make_error_code(std::errc::io_error);
+    }
+    if(!ec) fs::rename(tmp, target, ec);
+    if(ec){
+        fs::remove(tmp);
+        std::cerr << "Warning: cannot write autotune cache '" << path << "': " << ec.message() << "\n";
+    }
+}
+
+double time_candidate(const FlowField& initial, double nu, SolverOptions opts, int steps){
+    FlowField flow = initial;
+    ActivityMask activity;
+    opts.activity = &activity;
+    opts.stats = nullptr;
+    opts.health = nullptr;
+    solve_MHD(flow, compute_cfl_timestep(flow, opts.cfl), nu, opts);   // warm-up: first touch, caches
+    auto t0 = std::chrono::steady_clock::now();
+    for(int s = 0; s < steps; ++s)
+        solve_MHD(flow, compute_cfl_timestep(flow, opts.cfl), nu, opts);
+    std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - t0;
+    return ms.count() / std::max(steps, 1);
+}
+
+} // namespace
+
+std::string autotune_default_cache(){
+    char host[256] = "localhost";
+    gethostname(host, sizeof(host) - 1);
+    std::string dir;
+    if(const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) dir = xdg;
+    else if(const char* home = std::getenv("HOME"); home && *home) dir = std::string(home) + "/.cache";
+    else dir = ".";
+    return dir + "/mhd_solver/autotune-" + one_word(host) + ".txt";
+}
+
+std::string autotune_key(const FlowField& flow, const SolverOptions& opts){
+    std::ostringstream key;
+    key << one_word(cpu_model()) << "|procs=" << omp_get_num_procs()
+        << "|backend=" << (int)get_exec_backend() << "|grid=" << flow.rho.nx << "x" << flow.rho.ny
+        << "|divb=" << (int)opts.divb << "|diffusion=" << (int)opts.diffusion
+        << "|lts=" << (uses_lts(opts) ? opts.lts_levels : 1)
+        << "|positivity=" << opts.positivity << "|activity=" << (opts.activity_tol > 0.0)
+        << "|riemann=" << (int)opts.riemann << "|split=" << opts.split;
+#ifdef MHD_2P5D
+    key << "|2p5d";
+#endif
+    return key.str();
+}
+
+TuneResult autotune(const FlowField& flow, double nu, const SolverOptions& opts, int threads,
+                    const std::string& cache, int steps, bool refresh){
+    TuneResult result;
+    const std::string key = autotune_key(flow, opts);
+    if(!cache.empty() && !refresh && read_cache(cache, key, result.choice)){
+        if(threads > 0) result.choice.threads = threads;
+        result.cached = true;
+        return result;
+    }
+
+    std::vector<int> thread_counts;
+    if(threads > 0) thread_counts = {threads};
+    else if(get_exec_backend() == ExecBackend::StdPar) thread_counts = {exec_threads()};   // TBB picks its own
+    else
+        for(int t = exec_threads(); t >= 1 && thread_counts.size() < 4; t /= 2)
+            thread_counts.push_back(t);
+    std::vector<bool> fixed = {opts.fixed_size};
+    if(!uses_lts(opts) && !opts.split && has_fixed_kernel(flow)) fixed = {true, false};
+    std::vector<int> tiles = {0};
+    if(uses_lts(opts) || opts.activity_tol > 0.0) tiles = {8, 16, 32};
+
+    const int restore_threads = exec_threads();
+    result.choice.ms_per_step = 1e300;
+    for(int t : thread_counts)
+        for(bool f : fixed)
+            for(int tile : tiles){
+                TuneChoice c{t, f, tile, 0.0};
+                SolverOptions o = opts;
+                apply_tuning(c, o);
+                c.ms_per_step = time_candidate(flow, nu, o, steps);
+                ++result.candidates;
+                if(c.ms_per_step < result.choice.ms_per_step) result.choice = c;
+            }
+    set_exec_threads(restore_threads);
+    if(!cache.empty()) write_cache(cache, key, result.choice);
+    return result;
+}
+
+void apply_tuning(const TuneChoice& choice, SolverOptions& opts){
+    set_exec_threads(choice.threads);
+    opts.fixed_size = choice.fixed_size;
+    if(choice.tile > 0){
+        if(uses_lts(opts)) opts.lts_block = choice.tile;
+        else               opts.activity_tile = choice.tile;
+    }
+}
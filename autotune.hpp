@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include "solver.hpp"
+
+// Startup autotuning of the 2-D update. The candidates are:
+//  - the thread count of the execution backend (exec.hpp): the available
+//    threads, halved down to 1, at most four values;
+//  - the fixed-size kernel against the generic one, when a FixedDims
+//    specialisation matches the grid;
+//  - the tile edge of the activity mask or of the LTS blocks, when one of
+//    them is enabled.
+// Each candidate runs one warm-up step and then a few timed steps on a copy
+// of the initial state, and the fastest wins. The choice goes into a per-host
+// cache file, one line per key. The key holds the CPU model, the grid size
+// and the solver settings that change the kernels, so a later run with the
+// same key starts tuned without measuring.
+enum class Autotune {
+    Off,
+    On,        // use the cached choice, measure on a miss
+    Refresh    // always measure, then update the cache
+};
+
+struct TuneChoice {
+    int threads = 1;
+    bool fixed_size = true;
+    int tile = 0;              // activity_tile or lts_block, 0 if neither is tuned
+    double ms_per_step = 0.0;  // as measured when the choice was made
+};
+
+struct TuneResult {
+    TuneChoice choice;
+    bool cached = false;       // read from the cache, nothing measured
+    int candidates = 0;        // configurations measured
+};
+
+// $XDG_CACHE_HOME/mhd_solver/autotune-<hostname>.txt, or ~/.cache/... without it
+std::string autotune_default_cache();
+std::string autotune_key(const FlowField& flow, const SolverOptions& opts);
+
+// Tunes opts for flow (which is not modified). threads > 0 fixes the thread
+// count; cache = "" neither reads nor writes a cache file. A cache file that
+// cannot be written is reported on stderr and otherwise ignored.
+TuneResult autotune(const FlowField& flow, double nu, const SolverOptions& opts, int threads,
+                    const std::string& cache, int steps = 3, bool refresh = false);
+// Sets the choice in opts and the thread count of the execution backend
+void apply_tuning(const TuneChoice& choice, SolverOptions& opts);
@@ -0,0 +1,794 @@
+// Micro-benchmarks for solver options. Usage: ./mhd_bench <case> [N] [steps]
+#include "solver.hpp"
+#include "physics.hpp"
+#include "ct.hpp"
+#include "lts.hpp"
+#include "activity.hpp"
+#include "solver3d.hpp"
+#include "io.hpp"
+#include "tracers.hpp"
+#include "exec.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using bench_clock = std::chrono::steady_clock;
+
+static double total_energy(const FlowField& flow){
+    double sum = 0.0;
+    #pragma omp parallel for collapse(2) reduction(+:sum)
+    for(int i=1;i<flow.e.nx-1;++i)
+        for(int j=1;j<flow.e.ny-1;++j)
+            sum += flow.e.data[i][j];
+    return sum * flow.e.dx * flow.e.dy;
+}
+
+// GLM cleaning vs constrained transport on Orszag-Tang: cost per step and div B
+static void bench_divb(int n, int steps){
+    std::cout << "# divb: Orszag-Tang " << n << "x" << n << ", " << steps << " steps\n";
+    std::cout << std::setw(6) << "scheme" << std::setw(14) << "ms/step"
+              << std::setw(14) << "max_divB_cc" << std::setw(14) << "max_divB_face"
+              << std::setw(14) << "dE/E0" << "\n";
+    for(DivBScheme scheme : {DivBScheme::GLM, DivBScheme::CT}){
+        const double d = 1.0/(n-1);
+        FlowField flow(n,n,d,d);
+        initialize_orszag_tang(flow);
+        SolverOptions opts;
+        opts.divb = scheme;
+        const double e0 = total_energy(flow);
+
+        auto t0 = bench_clock::now();
+        for(int s=0;s<steps;++s)
+            solve_MHD(flow, compute_cfl_timestep(flow), 0.01, opts);
+        std::chrono::duration<double, std::milli> ms = bench_clock::now() - t0;
+
+        std::cout << std::setw(6) << (scheme == DivBScheme::CT ? "ct" : "glm")
+                  << std::setw(14) << ms.count()/steps
+                  << std::setw(14) << compute_divergence_errors(flow).first
+                  << std::setw(14);
+        // Faces are only evolved by CT
+        if(scheme == DivBScheme::CT) std::cout << compute_face_divergence_errors(flow).first;
+        else                         std::cout << "-";
+        std::cout
+                  << std::setw(14) << (total_energy(flow) - e0)/e0 << "\n";
+    }
+}
+
+// FFT projection cleaning: cost amortisation over the cleaning interval
+static void bench_projection(int n, int steps){
+    std::cout << "# projection: Orszag-Tang " << n << "x" << n << ", " << steps << " steps\n";
+    std::cout << std::setw(12) << "scheme" << std::setw(8) << "every" << std::setw(14) << "ms/step"
+              << std::setw(14) << "max_divB" << std::setw(14) << "L1_divB" << "\n";
+    struct Case { DivBScheme divb; int every; const char* name; };
+    for(const Case& c : {Case{DivBScheme::GLM, 0, "glm"}, Case{DivBScheme::GLM, 10, "glm+proj"},
+                         Case{DivBScheme::GLM, 50, "glm+proj"}, Case{DivBScheme::Projection, 1, "projection"},
+                         Case{DivBScheme::Projection, 10, "projection"}}){
+        const double d = 1.0/(n-1);
+        FlowField flow(n,n,d,d);
+        initialize_orszag_tang(flow);
+        SolverOptions opts;
+        opts.divb = c.divb;
+        opts.projection_every = c.every;
+
+        auto t0 = bench_clock::now();
+        for(int s=0;s<steps;++s)
+            solve_MHD(flow, compute_cfl_timestep(flow), 0.01, opts);
+        std::chrono::duration<double, std::milli> ms = bench_clock::now() - t0;
+
+        auto [max_divB, L1_divB] = compute_divergence_errors(flow);
+        std::cout << std::setw(12) << c.name << std::setw(8) << c.every
+                  << std::setw(14) << ms.count()/steps
+                  << std::setw(14) << max_divB << std::setw(14) << L1_divB << "\n";
+    }
+}
+
+static const char* diffusion_name(DiffusionScheme scheme){
+    switch(scheme){
+        case DiffusionScheme::RKL2:          return "rkl2";
+        case DiffusionScheme::CrankNicolson: return "cn";
+        case DiffusionScheme::BackwardEuler: return "be";
+        default:                             return "explicit";
+    }
+}
+
+// Explicit diffusion (parabolic dt limit) vs RKL2 super-time-stepping and implicit multigrid at large nu,
+// integrating to the same time; "du" is the L1 difference in u between the two
+static void bench_diffusion(int n, int steps){
+    const double t_end = 0.02;
+    std::cout << "# diffusion: Orszag-Tang " << n << "x" << n << " to t=" << t_end
+              << " (steps arg unused)\n";
+    std::cout << std::setw(8) << "nu" << std::setw(10) << "scheme" << std::setw(8) << "steps"
+              << std::setw(12) << "wall_s" << std::setw(10) << "speedup" << std::setw(14) << "du" << "\n";
+    (void)steps;
+    for(double nu : {0.01, 0.1, 0.5}){
+        std::vector<double> u_ref;
+        double wall_ref = 0.0;
+        for(DiffusionScheme scheme : {DiffusionScheme::Explicit, DiffusionScheme::RKL2,
+                                      DiffusionScheme::CrankNicolson, DiffusionScheme::BackwardEuler}){
+            const double d = 1.0/(n-1);
+            FlowField flow(n,n,d,d);
+            initialize_orszag_tang(flow);
+            SolverOptions opts;
+            opts.diffusion = scheme;
+
+            int nsteps = 0;
+            auto t0 = bench_clock::now();
+            for(double t = 0.0; t < t_end; ++nsteps){
+                double dt = compute_cfl_timestep(flow);
+                if(scheme == DiffusionScheme::Explicit)
+                    dt = std::min(dt, compute_parabolic_timestep(flow, nu));
+                dt = std::min(dt, t_end - t);
+                solve_MHD(flow, dt, nu, opts);
+                t += dt;
+            }
+            std::chrono::duration<double> wall = bench_clock::now() - t0;
+
+            double du = 0.0;
+            if(scheme == DiffusionScheme::Explicit){
+                wall_ref = wall.count();
+                for(int i=0;i<n;++i) for(int j=0;j<n;++j) u_ref.push_back(flow.u.data[i][j]);
+            } else {
+                for(int i=0;i<n;++i) for(int j=0;j<n;++j)
+                    du += std::abs(flow.u.data[i][j] - u_ref[(size_t)i*n + j]);
+                du /= (double)n*n;
+            }
+            std::cout << std::setw(8) << nu
+                      << std::setw(10) << diffusion_name(scheme)
+                      << std::setw(8) << nsteps << std::setw(12) << wall.count()
+                      << std::setw(10) << wall_ref / wall.count() << std::setw(14) << du << "\n";
+        }
+    }
+}
+
+// Local time stepping on the disk setup, whose centre sets the global dt;
+// "drho" is the mean |rho - rho_global| at the end
+static void bench_lts(int n, int steps){
+    const double t_end = 0.01;
+    std::cout << "# lts: MHD disk " << n << "x" << n << " to t=" << t_end << " (steps arg unused)\n";
+    std::cout << std::setw(8) << "levels" << std::setw(8) << "steps" << std::setw(12) << "wall_s"
+              << std::setw(14) << "updates" << std::setw(14) << "saved/t" << std::setw(14) << "drho" << "\n";
+    (void)steps;
+    std::vector<double> rho_ref;
+    for(int levels : {1, 2, 3, 4}){
+        const double d = 1.0/(n-1);
+        FlowField flow(n,n,d,d);
+        initialize_MHD_disk(flow);
+        SolverStats stats;
+        SolverOptions opts;
+        opts.lts_levels = levels;
+        opts.stats = &stats;
+
+        int nsteps = 0;
+        auto t0 = bench_clock::now();
+        for(double t = 0.0; t < t_end; ++nsteps){
+            double dt = levels > 1 ? compute_lts_timestep(flow, levels, opts.lts_block)
+                                   : compute_cfl_timestep(flow);
+            dt = std::min(dt, t_end - t);
+            solve_MHD(flow, dt, 0.01, opts);
+            t += dt;
+        }
+        std::chrono::duration<double> wall = bench_clock::now() - t0;
+
+        double drho = 0.0;
+        for(int i=1;i<n-1;++i)
+            for(int j=1;j<n-1;++j){
+                if(levels == 1) rho_ref.push_back(flow.rho.data[i][j]);
+                else drho += std::abs(flow.rho.data[i][j] - rho_ref[(size_t)(i-1)*(n-2) + (j-1)]);
+            }
+        std::cout << std::setw(8) << levels << std::setw(8) << nsteps << std::setw(12) << wall.count()
+                  << std::setw(14) << stats.cell_updates
+                  << std::setw(14) << (stats.cell_updates_global - stats.cell_updates)/stats.time
+                  << std::setw(14) << drho/((double)(n-2)*(n-2)) << "\n";
+    }
+}
+
+// Cost of runtime physics constants: the built-in values run the DefaultPhysics
+// specialisation, a perturbed gamma forces the RuntimePhysics one
+static void bench_config(int n, int steps){
+    std::cout << "# config: Orszag-Tang " << n << "x" << n << ", " << steps << " steps\n";
+    std::cout << std::setw(10) << "physics" << std::setw(14) << "ms/step" << "\n";
+    for(bool runtime : {false, true}){
+        PhysicsParams params;
+        if(runtime) params.gamma = DefaultPhysics::gamma * (1.0 + 1e-15);
+        set_physics_params(params);
+
+        const double d = 1.0/(n-1);
+        FlowField flow(n,n,d,d);
+        initialize_orszag_tang(flow);
+        auto t0 = bench_clock::now();
+        for(int s=0;s<steps;++s)
+            solve_MHD(flow, compute_cfl_timestep(flow), 0.01);
+        std::chrono::duration<double, std::milli> ms = bench_clock::now() - t0;
+        std::cout << std::setw(10) << (runtime ? "runtime" : "default")
+                  << std::setw(14) << ms.count()/steps << "\n";
+    }
+    set_physics_params(PhysicsParams());
+}
+
+// Legacy rho/E floors vs the positivity-preserving flux limiter on a strong,
+// low-beta blast wave at CFL 0.4 (the legacy path reports its floors on stderr)
+static void bench_positivity(int n, int steps){
+    std::cout << "# positivity: blast, p_in/p_out = 1000, |B| = 10, " << n << "x" << n
+              << ", " << steps << " steps at cfl 0.4\n";
+    std::cout << std::setw(10) << "fluxes" << std::setw(12) << "ms/step" << std::setw(14) << "dM/M0"
+              << std::setw(14) << "dE/E0" << std::setw(12) << "min_p"
+              << std::setw(10) << "limited" << std::setw(10) << "floored" << "\n";
+    for(bool positivity : {false, true}){
+        const double d = 1.0/(n-1);
+        FlowField flow(n,n,d,d);
+        initialize_blast(flow, 100.0, 10.0);
+        SolverStats stats;
+        SolverOptions opts;
+        opts.cfl = 0.4;
+        opts.positivity = positivity;
+        opts.stats = &stats;
+        auto mass = [&]{
+            double m = 0.0;
+            for(int i=1;i<n-1;++i) for(int j=1;j<n-1;++j) m += flow.rho.data[i][j];
+            return m;
+        };
+        const double m0 = mass(), e0 = total_energy(flow);
+
+        auto t0 = bench_clock::now();
+        for(int s=0;s<steps;++s)
+            solve_MHD(flow, compute_cfl_timestep(flow, opts.cfl), 0.0, opts);
+        std::chrono::duration<double, std::milli> ms = bench_clock::now() - t0;
+
+        double p_min = 1e300;
+        for(int i=1;i<n-1;++i) for(int j=1;j<n-1;++j) p_min = std::min(p_min, flow.p.data[i][j]);
+        std::cout << std::setw(10) << (positivity ? "limiter" : "floors")
+                  << std::setw(12) << ms.count()/steps
+                  << std::setw(14) << (mass() - m0)/m0
+                  << std::setw(14) << (total_energy(flow) - e0)/e0
+                  << std::setw(12) << p_min;
+        if(positivity) std::cout << std::setw(10) << stats.limited_faces << std::setw(10) << stats.floored_cells;
+        else           std::cout << std::setw(10) << "-" << std::setw(10) << "-";
+        std::cout << "\n";
+    }
+}
+
+// Activity mask on the blast wave, whose ambient medium stays quiescent until
+// the shock arrives, and on the disk (8^2 tiles), whose outer tiles change
+// slowly: step time, share of cell updates that reused stored fluxes, and the
+// largest deviation from the unmasked run (relative to each field's maximum).
+// Every run replays the unmasked run's time steps. The disk must skip cells
+// at tol 1e-3.
+static void bench_activity(int n, int steps){
+    const double d = 1.0/(n-1);
+    for(bool disk : {false, true}){
+        std::cout << "# activity: " << (disk ? "disk " : "blast ") << n << "x" << n << ", " << steps << " steps\n";
+        std::cout << std::setw(10) << "tol" << std::setw(12) << "ms/step" << std::setw(12) << "skipped"
+                  << std::setw(14) << "max_err" << "\n";
+        auto init = [&](FlowField& f){ if(disk) initialize_MHD_disk(f); else initialize_blast(f); };
+        FlowField ref(n,n,d,d);
+        init(ref);
+        std::vector<double> dts;
+        long disk_skipped = 0;
+        for(double tol : {0.0, 1e-6, 1e-4, 1e-3, 1e-2}){
+            FlowField flow(n,n,d,d);
+            init(flow);
+            SolverStats stats;
+            ActivityMask activity;
+            SolverOptions opts;
+            opts.activity_tol = tol;
+            if(disk) opts.activity_tile = 8;
+            opts.activity = &activity;
+            opts.stats = &stats;
+
+            auto t0 = bench_clock::now();
+            for(int s=0;s<steps;++s){
+                if(tol == 0.0) dts.push_back(compute_cfl_timestep(flow));
+                solve_MHD(flow, dts[s], 0.01, opts);
+            }
+            std::chrono::duration<double, std::milli> ms = bench_clock::now() - t0;
+            if(tol == 0.0) ref = flow;
+            if(tol == 1e-3) disk_skipped = stats.skipped_cells;
+
+            double err = 0.0;
+            for(auto f : {&FlowField::rho, &FlowField::u, &FlowField::v, &FlowField::p, &FlowField::bx, &FlowField::by}){
+                const Grid &a = ref.*f, &b = flow.*f;
+                double scale = 0.0, diff = 0.0;
+                for(int i=1;i<n-1;++i)
+                    for(int j=1;j<n-1;++j){
+                        scale = std::max(scale, std::abs(a.data[i][j]));
+                        diff = std::max(diff, std::abs(a.data[i][j] - b.data[i][j]));
+                    }
+                if(scale > 0.0) err = std::max(err, diff/scale);
+            }
+            std::cout << std::setw(10) << tol << std::setw(12) << ms.count()/steps
+                      << std::setw(11) << 100.0*stats.skipped_cells/stats.cell_updates << "%"
+                      << std::setw(14) << err << "\n";
+        }
+        if(disk)
+            std::cout << "disk at tol 1e-3: " << disk_skipped << " cell updates skipped "
+                      << (disk_skipped > 0 ? "ok" : "NONE") << "\n";
+    }
+}
+
+// Total energy from the primitives: a field expression against the same
+// formula as a flat hand-fused loop and as the (i, j) loop it replaced
+static void bench_expr(int n, int steps){
+    std::cout << "# expr: e = p/(gamma-1) + 0.5 rho |u|^2 + 0.5 |B|^2 on " << n << "x" << n
+              << ", " << steps << " evaluations\n";
+    const double d = 1.0/(n-1), gamma = DefaultPhysics::gamma;
+    FlowField flow(n,n,d,d);
+    initialize_orszag_tang(flow);
+    const size_t cells = flow.e.data.size();
+
+    auto time = [&](const char* name, auto&& eval){
+        eval();
+        auto t0 = bench_clock::now();
+        for(int s=0;s<steps;++s) eval();
+        std::chrono::duration<double, std::milli> ms = bench_clock::now() - t0;
+        double checksum = 0.0;
+        for(size_t k=0;k<cells;++k) checksum += flow.e.data.ptr()[k];
+        // 7 fields read, 1 written
+        std::cout << std::setw(12) << name << std::setw(14) << ms.count()/steps
+                  << std::setw(14) << 8.0*sizeof(double)*cells*steps / (ms.count()*1e6)
+                  << std::setw(22) << std::setprecision(15) << checksum << std::setprecision(6) << "\n";
+    };
+    std::cout << std::setw(12) << "variant" << std::setw(14) << "ms/eval" << std::setw(14) << "GB/s"
+              << std::setw(22) << "checksum" << "\n";
+    time("ij-loop", [&]{
+        #pragma omp parallel for collapse(2)
+        for(int i=0;i<n;++i)
+            for(int j=0;j<n;++j){
+                double rho = flow.rho.data[i][j], u = flow.u.data[i][j], v = flow.v.data[i][j];
+                double Bx = flow.bx.data[i][j], By = flow.by.data[i][j];
+                flow.e.data[i][j] = flow.p.data[i][j]/(gamma - 1.0) + 0.5*rho*(u*u + v*v)
+                                  + 0.5*(Bx*Bx + By*By);
+            }
+    });
+    time("hand-fused", [&]{
+        const double *rho = flow.rho.data.ptr(), *u = flow.u.data.ptr(), *v = flow.v.data.ptr();
+        const double *p = flow.p.data.ptr(), *bx = flow.bx.data.ptr(), *by = flow.by.data.ptr();
+        double* e = flow.e.data.ptr();
+        #pragma omp parallel for simd
+        for(size_t k=0;k<cells;++k)
+            e[k] = p[k]/(gamma - 1.0) + 0.5*rho[k]*(u[k]*u[k] + v[k]*v[k]) + 0.5*(bx[k]*bx[k] + by[k]*by[k]);
+    });
+    time("expression", [&]{
+        flow.e = flow.p/(gamma - 1.0) + 0.5*flow.rho*(flow.u*flow.u + flow.v*flow.v)
+               + 0.5*(flow.bx*flow.bx + flow.by*flow.by);
+    });
+}
+
+// Compile-time grid-size specialisation against the generic path on the
+// production grid sizes (N is ignored; both paths give identical results)
+static void bench_fixed(int, int steps){
+    std::cout << "# fixed: Orszag-Tang, " << steps << " steps\n";
+    std::cout << std::setw(8) << "grid" << std::setw(14) << "generic ms" << std::setw(14) << "fixed ms"
+              << std::setw(10) << "speedup" << "\n";
+    for(int n : {64, 128}){
+        // Best of three alternating runs, to keep machine noise out of the ratio
+        double ms[2] = {1e300, 1e300};
+        for(int rep=0;rep<3;++rep){
+            for(bool fixed : {false, true}){
+                const double d = 1.0/(n-1);
+                FlowField flow(n,n,d,d);
+                initialize_orszag_tang(flow);
+                SolverOptions opts;
+                opts.fixed_size = fixed;
+                auto t0 = bench_clock::now();
+                for(int s=0;s<steps;++s)
+                    solve_MHD(flow, compute_cfl_timestep(flow), 0.01, opts);
+                std::chrono::duration<double, std::milli> t = bench_clock::now() - t0;
+                ms[fixed] = std::min(ms[fixed], t.count()/steps);
+            }
+        }
+        std::cout << std::setw(5) << n << "^2" << std::setw(14) << ms[0] << std::setw(14) << ms[1]
+                  << std::setw(10) << ms[0]/ms[1] << "\n";
+    }
+}
+
+// Data-TLB read misses of the calling thread (user space), or -1 if the
+// kernel gives no access to the hardware counters
+struct DtlbCounter {
+    int fd = -1;
+    DtlbCounter(){
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~DtlbCounter(){ if(fd >= 0) close(fd); }
+    void start(){ if(fd >= 0){ ioctl(fd, PERF_EVENT_IOC_RESET, 0); ioctl(fd, PERF_EVENT_IOC_ENABLE, 0); } }
+    long long stop(){
+        long long n = -1;
+        if(fd < 0) return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if(read(fd, &n, sizeof(n)) != sizeof(n)) n = -1;
+        return n;
+    }
+};
+
+// Huge-page backing of the field buffers: step time and DTLB misses with
+// normal pages, THP and auto (explicit huge pages first) at a large grid.
+// Counts need one thread and access to perf events; otherwise they print "-".
+static void bench_hugepages(int n, int steps){
+    if(n < 512) n = 1024;   // the effect only shows once the working set outgrows the TLB reach
+    std::cout << "# hugepages: Orszag-Tang " << n << "x" << n << ", " << steps << " steps\n";
+    std::cout << std::setw(6) << "pages" << std::setw(14) << "ms/step" << std::setw(16) << "dTLB misses"
+              << "  backing\n";
+    const HugePages saved = get_huge_pages();
+    struct Case { HugePages mode; const char* name; };
+    const Case cases[] = {{HugePages::Off, "off"}, {HugePages::Transparent, "thp"}, {HugePages::Auto, "auto"}};
+    // Best of three alternating runs, to keep machine noise out of the comparison
+    double ms[3] = {1e300, 1e300, 1e300};
+    long long misses[3] = {-1, -1, -1};
+    std::string backing[3];
+    for(int rep=0;rep<3;++rep){
+        for(int c=0;c<3;++c){
+            set_huge_pages(cases[c].mode);
+            const double d = 1.0/(n-1);
+            FlowField flow(n,n,d,d);
+            initialize_orszag_tang(flow);
+            solve_MHD(flow, compute_cfl_timestep(flow), 0.01);   // first touch outside the timed region
+
+            DtlbCounter dtlb;
+            auto t0 = bench_clock::now();
+            dtlb.start();
+            for(int s=0;s<steps;++s)
+                solve_MHD(flow, compute_cfl_timestep(flow), 0.01);
+            long long m = dtlb.stop();
+            std::chrono::duration<double, std::milli> t = bench_clock::now() - t0;
+            if(t.count()/steps < ms[c]){
+                ms[c] = t.count()/steps;
+                misses[c] = m;
+            }
+            backing[c] = huge_page_report();
+        }
+    }
+    for(int c=0;c<3;++c){
+        std::cout << std::setw(6) << cases[c].name << std::setw(14) << ms[c] << std::setw(16);
+        if(misses[c] >= 0) std::cout << misses[c];
+        else               std::cout << "-";
+        std::cout << "  " << backing[c] << "\n";
+    }
+    set_huge_pages(saved);
+}
+
+// 3-D solver on the 3-D Orszag-Tang problem: throughput and memory per cell
+static void bench_3d(int n, int steps){
+    std::cout << "# 3d: Orszag-Tang " << n << "^3, " << steps << " steps\n";
+    const double d = 1.0/n;
+    FlowField3D flow(n,n,n,d,d,d);
+    initialize_orszag_tang_3d(flow);
+    const double cells = (double)n*n*n;
+    const double scratch = 8.0 * NVAR3D * flow.grid.plane() * sizeof(double);
+
+    auto t0 = bench_clock::now();
+    for(int s=0;s<steps;++s)
+        solve_MHD_3d(flow, compute_cfl_timestep_3d(flow), 0.01);
+    std::chrono::duration<double, std::milli> ms = bench_clock::now() - t0;
+
+    std::cout << std::setw(14) << "ms/step" << std::setw(14) << "Mcell/s"
+              << std::setw(14) << "bytes/cell" << std::setw(14) << "max_divB" << "\n";
+    std::cout << std::setw(14) << ms.count()/steps
+              << std::setw(14) << cells*steps / (ms.count()*1e3)
+              << std::setw(14) << (flow.bytes() + scratch) / cells
+              << std::setw(14) << compute_divergence_errors_3d(flow).first << "\n";
+}
+
+// Full dumps of every step: CSV files against the snapshot container, raw
+// and delta-encoded (lossless and rounded to 20 mantissa bits). Reports the
+// bytes and time per dump, and checks that the last step reads back.
+static void bench_snapshots(int n, int steps){
+    std::cout << "# snapshots: Orszag-Tang " << n << "x" << n << ", " << steps << " dumps, one per step"
+              << (snapshot_compression_available() ? "" : " (no zlib: container records are raw)") << "\n";
+    std::cout << std::setw(18) << "format" << std::setw(14) << "KB/dump" << std::setw(14) << "ms/dump"
+              << std::setw(10) << "vs csv" << "  read back\n";
+    const std::string base = (std::filesystem::temp_directory_path() / "mhd_bench_snapshots").string();
+    struct Case { const char* name; int keyframe, bits; };
+    const Case cases[] = {{"csv", -1, 0}, {"raw", 0, 52}, {"delta", 16, 52}, {"delta 20 bits", 16, 20}};
+    double csv_bytes = 0.0;
+    for(const Case& c : cases){
+        std::filesystem::remove_all(base);
+        const double d = 1.0/(n-1);
+        FlowField flow(n,n,d,d);
+        initialize_orszag_tang(flow);
+        std::unique_ptr<SnapshotWriter> out;
+        if(c.keyframe >= 0) out = std::make_unique<SnapshotWriter>(base, snapshot_layout(flow), c.keyframe, c.bits);
+        std::vector<std::vector<double>> last;
+        double ms = 0.0, t = 0.0;
+        for(int s=0;s<steps;++s){
+            const double dt = compute_cfl_timestep(flow);
+            solve_MHD(flow, dt, 0.01);
+            t += dt;
+            auto t0 = bench_clock::now();
+            if(out) save_flow_snapshot(*out, flow, s, t);
+            else    save_flow_MHD(flow, base, s);
+            ms += std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+        }
+        double bytes = 0.0;
+        for(const auto& f : std::filesystem::directory_iterator(base)) bytes += std::filesystem::file_size(f);
+        if(c.keyframe < 0) csv_bytes = bytes;
+        std::string check = "-";
+        if(out){
+            // The last step, rebuilt from its keyframe and deltas, against the state
+            SnapshotReader in(base);
+            const double tol = c.bits < 52 ? std::ldexp(1.0, -c.bits) : 0.0;
+            bool ok = in.entries().size() == (size_t)steps;
+            const double* rho = flow.rho.data.ptr();
+            const std::vector<double> r = in.read(in.entries().size()-1, "rho");
+            for(size_t k = 0; ok && k < r.size(); ++k) ok = std::abs(r[k] - rho[k]) <= tol * std::abs(rho[k]);
+            check = ok ? "ok" : "MISMATCH";
+        }
+        std::cout << std::setw(18) << c.name << std::setw(14) << bytes/steps/1024.0 << std::setw(14) << ms/steps
+                  << std::setw(10);
+        if(c.keyframe >= 0) std::cout << csv_bytes / bytes;
+        else                std::cout << "-";
+        std::cout << "  " << check << "\n";
+    }
+    std::filesystem::remove_all(base);
+}
+
+// Peak resident set of the process so far, in MB (VmHWM)
+static void bench_tracers(int n, int steps){
+    const long count = 64L*n*n;
+    std::cout << "# tracers: Orszag-Tang " << n << "x" << n << ", " << count << " particles, " << steps
+              << " steps\n";
+    std::cout << std::setw(12) << "sort every" << std::setw(14) << "push ms" << std::setw(14) << "sort ms"
+              << std::setw(14) << "ns/particle" << "\n";
+    const int every[] = {0, 100, 20, 1};
+    std::vector<float> first;
+    bool same = true;
+    for(int e : every){
+        const double d = 1.0/(n-1);
+        FlowField flow(n,n,d,d);
+        initialize_orszag_tang(flow);
+        Tracers tr(flow, count);
+        double push = 0.0, sort = 0.0;
+        for(int s=0;s<steps;++s){
+            if(e > 0 && s % e == 0){
+                auto t0 = bench_clock::now();
+                tr.sort(flow);
+                sort += std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+            }
+            const double dt = compute_cfl_timestep(flow);
+            auto t0 = bench_clock::now();
+            tr.predict(flow, dt);
+            push += std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+            solve_MHD(flow, dt, 0.01);
+            t0 = bench_clock::now();
+            tr.correct(flow, dt);
+            push += std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count();
+        }
+        // The push is per particle, so the order must not change any trajectory
+        std::vector<float> pos(2*count);
+        for(size_t k = 0; k < tr.size(); ++k){
+            pos[2*tr.id()[k]] = (float)tr.x()[k];
+            pos[2*tr.id()[k]+1] = (float)tr.y()[k];
+        }
+        if(first.empty()) first = pos;
+        else same = same && pos == first;
+        std::cout << std::setw(12) << (e > 0 ? std::to_string(e) : "never") << std::setw(14) << push/steps
+                  << std::setw(14) << sort/steps << std::setw(14) << 1e6*(push + sort)/steps/count << "\n";
+    }
+    std::cout << "trajectories " << (same ? "identical" : "DIFFER") << "\n";
+}
+
+// Strang-split update against the unsplit one on Orszag-Tang: throughput in
+// cell updates per second, with the x sweep gathering strided columns or
+// working on a tiled transpose, and the largest density deviation from the
+// unsplit run (relative to its maximum). Every run replays the unsplit run's
+// steps.
+static void bench_split(int n, int steps){
+    std::cout << "# split: Orszag-Tang " << n << "x" << n << ", " << steps << " steps\n";
+    std::cout << std::setw(18) << "update" << std::setw(12) << "ms/step" << std::setw(14) << "Mcells/s"
+              << std::setw(14) << "max drho" << "\n";
+    struct Mode { const char* name; bool split, transpose; };
+    const Mode modes[] = {{"unsplit", false, false}, {"split strided", true, false}, {"split transposed", true, true}};
+    std::vector<double> dts, rho_ref;
+    for(const Mode& m : modes){
+        const double d = 1.0/(n-1);
+        FlowField flow(n,n,d,d);
+        initialize_orszag_tang(flow);
+        SolverOptions opts;
+        opts.split = m.split;
+        opts.split_transpose = m.transpose;
+        const bool ref = dts.empty();
+        auto t0 = bench_clock::now();
+        for(int s=0;s<steps;++s){
+            if(ref) dts.push_back(compute_cfl_timestep(flow, opts.cfl));
+            solve_MHD(flow, dts[s], 0.01, opts);
+        }
+        const double ms = std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count()/steps;
+        const double* rho = flow.rho.data.ptr();
+        if(ref) rho_ref.assign(rho, rho + flow.rho.data.size());
+        double dev = 0.0, top = 0.0;
+        for(size_t k = 0; k < rho_ref.size(); ++k){
+            dev = std::max(dev, std::abs(rho[k] - rho_ref[k]));
+            top = std::max(top, std::abs(rho_ref[k]));
+        }
+        std::cout << std::setw(18) << m.name << std::setw(12) << ms
+                  << std::setw(14) << (double)(n-2)*(n-2)/ms/1e3 << std::setw(14) << dev/top << "\n";
+    }
+}
+
+// Face Riemann solvers on Orszag-Tang, from the state at t = 0.3 when the
+// shocks and current sheets have formed: step time against HLL, the share of
+// faces the hybrid sends to HLL, and the largest density deviation from the
+// HLL run (relative to its maximum). Every run replays the HLL run's steps.
+static void bench_riemann(int n, int steps){
+    std::cout << "# riemann: Orszag-Tang " << n << "x" << n << ", " << steps << " steps from t = 0.3\n";
+    std::cout << std::setw(16) << "solver" << std::setw(12) << "ms/step" << std::setw(10) << "speedup"
+              << std::setw(10) << "HLL %" << std::setw(14) << "max drho" << "\n";
+    struct Mode { const char* name; RiemannSolver riemann; double threshold; };
+    const Mode modes[] = {{"hll", RiemannSolver::HLL, 0.0}, {"rusanov", RiemannSolver::Rusanov, 0.0},
+                          {"hybrid 0.3", RiemannSolver::Hybrid, 0.3}, {"hybrid 0.1", RiemannSolver::Hybrid, 0.1},
+                          {"hybrid 0.03", RiemannSolver::Hybrid, 0.03}};
+    const double d = 1.0/(n-1);
+    FlowField start(n,n,d,d);
+    initialize_orszag_tang(start);
+    for(double t = 0.0; t < 0.3; ){
+        const double dt = std::min(compute_cfl_timestep(start), 0.3 - t);
+        solve_MHD(start, dt, 0.01);
+        t += dt;
+    }
+    // Untimed HLL pass for the steps and the reference density
+    std::vector<double> dts;
+    FlowField ref = start;
+    for(int s=0;s<steps;++s){
+        dts.push_back(compute_cfl_timestep(ref));
+        solve_MHD(ref, dts.back(), 0.01);
+    }
+    const std::vector<double> rho_ref(ref.rho.data.ptr(), ref.rho.data.ptr() + ref.rho.data.size());
+    double ms_ref = 0.0;
+    for(const Mode& m : modes){
+        FlowField flow = start;
+        SolverStats stats;
+        SolverOptions opts;
+        opts.riemann = m.riemann;
+        opts.riemann_threshold = m.threshold;
+        opts.stats = &stats;
+        auto t0 = bench_clock::now();
+        for(int s=0;s<steps;++s) solve_MHD(flow, dts[s], 0.01, opts);
+        const double ms = std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count()/steps;
+        const bool hll = m.riemann == RiemannSolver::HLL;
+        if(hll) ms_ref = ms;
+        const double* rho = flow.rho.data.ptr();
+        double dev = 0.0, top = 0.0;
+        for(size_t k = 0; k < rho_ref.size(); ++k){
+            dev = std::max(dev, std::abs(rho[k] - rho_ref[k]));
+            top = std::max(top, std::abs(rho_ref[k]));
+        }
+        const long faces = stats.rusanov_faces + stats.hll_faces;
+        std::cout << std::setw(16) << m.name << std::setw(12) << ms << std::setw(10) << ms_ref/ms
+                  << std::setw(10) << (hll ? 100.0 : faces > 0 ? 100.0*stats.hll_faces/faces : 0.0)
+                  << std::setw(14) << dev/top << "\n";
+    }
+}
+
+// The execution backends on the same run: time per step on a small grid,
+// where the fork/join cost of a loop shows, and on the given one, plus the
+// cost of an empty parallel loop. The state must come out identical.
+static void bench_backends(int n, int steps){
+    std::cout << "# backends: Orszag-Tang, " << steps << " steps\n";
+    std::cout << std::setw(10) << "backend" << std::setw(10) << "threads" << std::setw(14) << "32 ms/step"
+              << std::setw(14) << std::to_string(n) + " ms/step" << std::setw(14) << "empty us" << "\n";
+    const std::pair<const char*, ExecBackend> backends[] = {
+        {"openmp", ExecBackend::OpenMP}, {"stdpar", ExecBackend::StdPar}, {"pool", ExecBackend::Pool}};
+    const ExecBackend restore = get_exec_backend();
+    std::vector<double> first;
+    bool same = true;
+    for(const auto& [name, backend] : backends){
+        set_exec_backend(backend);
+        double ms[2] = {0.0, 0.0};
+        for(int size : {32, n}){
+            const double d = 1.0/(size-1);
+            FlowField flow(size,size,d,d);
+            initialize_orszag_tang(flow);
+            solve_MHD(flow, compute_cfl_timestep(flow), 0.01);   // warm-up: thread start, first touch
+            auto t0 = bench_clock::now();
+            for(int s=0;s<steps;++s) solve_MHD(flow, compute_cfl_timestep(flow), 0.01);
+            ms[size == n] = std::chrono::duration<double, std::milli>(bench_clock::now() - t0).count()/steps;
+            if(size == n){
+                std::vector<double> rho(flow.rho.data.ptr(), flow.rho.data.ptr() + flow.rho.data.size());
+                if(first.empty()) first = rho;
+                else same = same && rho == first;
+            }
+        }
+        const int reps = 10000;
+        std::vector<int> sink(64);
+        auto t0 = bench_clock::now();
+        for(int r=0;r<reps;++r) exec::for_each(0, (long)sink.size(), [&](long k){ sink[k] += r; });
+        const double empty = std::chrono::duration<double, std::micro>(bench_clock::now() - t0).count()/reps;
+        std::cout << std::setw(10) << name << std::setw(10) << exec_threads() << std::setw(14) << ms[0]
+                  << std::setw(14) << ms[1] << std::setw(14) << empty << "\n";
+    }
+    set_exec_backend(restore);
+    std::cout << "state " << (same ? "identical" : "DIFFERS") << "\n";
+}
+
+static double peak_rss_mb(){
+    std::ifstream in("/proc/self/status");
+    std::string line;
+    while(std::getline(in, line))
+        if(line.rfind("VmHWM:", 0) == 0) return std::atof(line.c_str() + 6) / 1024.0;
+    return -1.0;
+}
+
+// Out-of-core 3-D state: the file-backed sweep against the in-memory one.
+// The file-backed run goes first, so the peak RSS after it is its own.
+static void bench_ooc(int n, int steps){
+    std::cout << "# ooc: Orszag-Tang " << n << "^3, " << steps << " steps\n";
+    const std::string file = (std::filesystem::temp_directory_path() / "mhd_bench_ooc.bin").string();
+    const double d = 1.0/n;
+    std::vector<double> rho[2];
+    std::cout << std::setw(10) << "state" << std::setw(14) << "ms/step" << std::setw(14) << "state MB"
+              << std::setw(14) << "peak RSS MB" << "\n";
+    for(int c=0;c<2;++c){
+        FlowField3D flow(n,n,n,d,d,d, 0.0,0.0,0.0, c == 0 ? file : "");
+        initialize_orszag_tang_3d(flow);
+        auto t0 = bench_clock::now();
+        for(int s=0;s<steps;++s)
+            solve_MHD_3d(flow, compute_cfl_timestep_3d(flow), 0.01);
+        std::chrono::duration<double, std::milli> ms = bench_clock::now() - t0;
+        rho[c].assign(flow.var(RHO3), flow.var(RHO3) + flow.grid.size());
+        std::cout << std::setw(10) << (c == 0 ? "file" : "memory") << std::setw(14) << ms.count()/steps
+                  << std::setw(14) << flow.bytes() / 1048576.0 << std::setw(14) << peak_rss_mb() << "\n";
+    }
+    std::cout << "results " << (rho[0] == rho[1] ? "identical" : "DIFFER") << "\n";
+}
+
+int main(int argc, char** argv){
+    const std::vector<std::pair<std::string, std::function<void(int,int)>>> cases = {
+        {"divb", bench_divb},
+        {"projection", bench_projection},
+        {"diffusion", bench_diffusion},
+        {"lts", bench_lts},
+        {"config", bench_config},
+        {"positivity", bench_positivity},
+        {"activity", bench_activity},
+        {"expr", bench_expr},
+        {"fixed", bench_fixed},
+        {"hugepages", bench_hugepages},
+        {"3d", bench_3d},
+        {"ooc", bench_ooc},
+        {"snapshots", bench_snapshots},
+        {"tracers", bench_tracers},
+        {"backends", bench_backends},
+        {"riemann", bench_riemann},
+        {"split", bench_split},
+    };
+    std::string name = argc > 1 ? argv[1] : "all";
+    int n     = argc > 2 ? std::atoi(argv[2]) : 128;
+    int steps = argc > 3 ? std::atoi(argv[3]) : 100;
+
+    bool found = false;
+    for(const auto& [case_name, fn] : cases){
+        if(name == "all" || name == case_name){
+            fn(n, steps);
+            found = true;
+        }
+    }
+    if(!found){
+        std::cerr << "unknown benchmark '" << name << "'; available:";
+        for(const auto& c : cases) std::cerr << ' ' << c.first;
+        std::cerr << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,7 @@
+#!/bin/bash
+# Build and run the solver micro-benchmarks: bash bench.sh [case] [N] [steps]
+
+source "$(dirname "$0")/detect_deps.sh"
+
+g++ bench.cpp grid.cpp physics.cpp solver.cpp ct.cpp fft.cpp projection.cpp diffusion.cpp multigrid.cpp lts.cpp split.cpp activity.cpp grid3d.cpp solver3d.cpp config.cpp hugepage.cpp io.cpp snapshot.cpp tracers.cpp rollback.cpp autotune.cpp exec.cpp -std=c++17 -O2 -fopenmp $CXXFLAGS $ZLIB $FFTW $TBB -o mhd_bench
+./mhd_bench "$@"
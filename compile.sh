@@ -1,4 +1,6 @@
 #!/bin/bash
 # Compile the magnetohydrodynamics solver
 
-g++ main.cpp grid.cpp physics.cpp solver.cpp io.cpp -std=c++17 -O2 -fopenmp -o mhd_solver
+source "$(dirname "$0")/detect_deps.sh"
+
+g++ main.cpp grid.cpp physics.cpp solver.cpp ct.cpp fft.cpp projection.cpp diffusion.cpp multigrid.cpp lts.cpp split.cpp activity.cpp grid3d.cpp solver3d.cpp config.cpp hugepage.cpp io.cpp snapshot.cpp tracers.cpp rollback.cpp autotune.cpp exec.cpp -std=c++17 -O2 -fopenmp $CXXFLAGS $ZLIB $FFTW $TBB -o mhd_solver
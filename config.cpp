@@ -0,0 +1,266 @@
+#include "config.hpp"
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+using Setter = std::function<void(RunConfig&, const std::string&)>;
+
+int to_int(const std::string& key, const std::string& v){
+    size_t pos = 0;
+    int x = 0;
+    try { x = std::stoi(v, &pos); } catch(const std::exception&) { pos = 0; }
+    if(pos == 0 || pos != v.size())
+        throw std::invalid_argument("config: '" + key + "' expects an integer, got '" + v + "'");
+    return x;
+}
+
+double to_double(const std::string& key, const std::string& v){
+    size_t pos = 0;
+    double x = 0.0;
+    try { x = std::stod(v, &pos); } catch(const std::exception&) { pos = 0; }
+    if(pos == 0 || pos != v.size())
+        throw std::invalid_argument("config: '" + key + "' expects a number, got '" + v + "'");
+    return x;
+}
+
+template <class E>
+E to_enum(const std::string& key, const std::string& v, const std::map<std::string, E>& names){
+    auto it = names.find(v);
+    if(it == names.end())
+        throw std::invalid_argument("config: invalid value '" + v + "' for '" + key + "'");
+    return it->second;
+}
+
+const std::map<std::string, DivBScheme> divb_names = {
+    {"glm", DivBScheme::GLM}, {"ct", DivBScheme::CT}, {"projection", DivBScheme::Projection}};
+const std::map<std::string, DiffusionScheme> diffusion_names = {
+    {"explicit", DiffusionScheme::Explicit}, {"rkl2", DiffusionScheme::RKL2},
+    {"cn", DiffusionScheme::CrankNicolson}, {"be", DiffusionScheme::BackwardEuler}};
+const std::map<std::string, RiemannSolver> riemann_names = {
+    {"hll", RiemannSolver::HLL}, {"rusanov", RiemannSolver::Rusanov}, {"hybrid", RiemannSolver::Hybrid}};
+const std::map<std::string, HugePages> huge_page_names = {
+    {"off", HugePages::Off}, {"thp", HugePages::Transparent}, {"auto", HugePages::Auto}};
+const std::map<std::string, OutputFormat> output_format_names = {
+    {"csv", OutputFormat::CSV}, {"snapshots", OutputFormat::Snapshots}, {"both", OutputFormat::Both}};
+const std::map<std::string, ExecBackend> backend_names = {
+    {"openmp", ExecBackend::OpenMP}, {"stdpar", ExecBackend::StdPar}, {"pool", ExecBackend::Pool}};
+const std::map<std::string, Autotune> autotune_names = {
+    {"off", Autotune::Off}, {"on", Autotune::On}, {"refresh", Autotune::Refresh}};
+const std::map<std::string, bool> bool_names = {
+    {"true", true}, {"false", false}, {"1", true}, {"0", false}, {"on", true}, {"off", false}};
+
+template <class E>
+std::string enum_name(E e, const std::map<std::string, E>& names){
+    for(const auto& [name, value] : names)
+        if(value == e) return name;
+    return "?";
+}
+
+#define INT_KEY(name, field)    {name, [](RunConfig& c, const std::string& v){ c.field = to_int(name, v); }}
+#define DOUBLE_KEY(name, field) {name, [](RunConfig& c, const std::string& v){ c.field = to_double(name, v); }}
+
+const std::map<std::string, Setter>& setters(){
+    static const std::map<std::string, Setter> table = {
+        INT_KEY("nx", nx), INT_KEY("ny", ny), INT_KEY("nz", nz),
+        DOUBLE_KEY("Lx", Lx), DOUBLE_KEY("Ly", Ly), DOUBLE_KEY("Lz", Lz),
+        INT_KEY("max_steps", max_steps), DOUBLE_KEY("t_end", t_end),
+        INT_KEY("output_every", output_every),
+        {"output_dir", [](RunConfig& c, const std::string& v){ c.output_dir = v; }},
+        {"output_format", [](RunConfig& c, const std::string& v){
+            c.output_format = to_enum("output_format", v, output_format_names);
+        }},
+        INT_KEY("snapshot_keyframe", snapshot_keyframe), INT_KEY("snapshot_bits", snapshot_bits),
+        INT_KEY("tracers", tracers), INT_KEY("tracer_every", tracer_every), INT_KEY("tracer_sort", tracer_sort),
+        {"output", [](RunConfig& c, const std::string& v){ c.outputs.push_back(parse_output_spec(v)); }},
+        {"init", [](RunConfig& c, const std::string& v){
+            bool alfven = false;
+#ifdef MHD_2P5D
+            alfven = (v == "alfven");
+#endif
+            if(v != "orszag_tang" && v != "disk" && v != "blast" && !alfven)
+                throw std::invalid_argument("config: invalid value '" + v + "' for 'init'");
+            c.init = v;
+        }},
+        INT_KEY("seed", seed), DOUBLE_KEY("divergence_error", divergence_error),
+        DOUBLE_KEY("nu", nu),
+        DOUBLE_KEY("eta", physics.eta), DOUBLE_KEY("ch", physics.ch),
+        DOUBLE_KEY("cr", physics.cr), DOUBLE_KEY("gamma", physics.gamma),
+        DOUBLE_KEY("cfl", solver.cfl),
+        {"divb", [](RunConfig& c, const std::string& v){ c.solver.divb = to_enum("divb", v, divb_names); }},
+        INT_KEY("projection_every", solver.projection_every),
+        {"diffusion", [](RunConfig& c, const std::string& v){
+            c.solver.diffusion = to_enum("diffusion", v, diffusion_names);
+        }},
+        INT_KEY("lts_levels", solver.lts_levels), INT_KEY("lts_block", solver.lts_block),
+        {"positivity", [](RunConfig& c, const std::string& v){
+            c.solver.positivity = to_enum("positivity", v, bool_names);
+        }},
+        {"fixed_size", [](RunConfig& c, const std::string& v){
+            c.solver.fixed_size = to_enum("fixed_size", v, bool_names);
+        }},
+        DOUBLE_KEY("activity_tol", solver.activity_tol), INT_KEY("activity_tile", solver.activity_tile),
+        {"riemann", [](RunConfig& c, const std::string& v){ c.solver.riemann = to_enum("riemann", v, riemann_names); }},
+        DOUBLE_KEY("riemann_threshold", solver.riemann_threshold),
+        {"split", [](RunConfig& c, const std::string& v){ c.solver.split = to_enum("split", v, bool_names); }},
+        {"split_transpose", [](RunConfig& c, const std::string& v){
+            c.solver.split_transpose = to_enum("split_transpose", v, bool_names);
+        }},
+        INT_KEY("rollback_depth", rollback_depth), INT_KEY("rollback_every", rollback_every),
+        DOUBLE_KEY("rollback_cfl", rollback_cfl),
+        INT_KEY("threads", threads),
+        {"backend", [](RunConfig& c, const std::string& v){ c.backend = to_enum("backend", v, backend_names); }},
+        {"autotune", [](RunConfig& c, const std::string& v){ c.autotune = to_enum("autotune", v, autotune_names); }},
+        {"autotune_cache", [](RunConfig& c, const std::string& v){ c.autotune_cache = v; }},
+        INT_KEY("autotune_steps", autotune_steps),
+        {"huge_pages", [](RunConfig& c, const std::string& v){
+            c.huge_pages = to_enum("huge_pages", v, huge_page_names);
+        }},
+        {"out_of_core", [](RunConfig& c, const std::string& v){ c.out_of_core = v; }},
+        INT_KEY("ooc_slab", ooc_slab),
+    };
+    return table;
+}
+
+#undef INT_KEY
+#undef DOUBLE_KEY
+
+std::string trim(const std::string& s){
+    size_t b = s.find_first_not_of(" \t\r");
+    if(b == std::string::npos) return "";
+    size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+} // namespace
+
+void set_config_value(RunConfig& cfg, const std::string& key, const std::string& value){
+    auto it = setters().find(key);
+    if(it == setters().end())
+        throw std::invalid_argument("config: unknown key '" + key + "'");
+    it->second(cfg, value);
+}
+
+void load_config_file(RunConfig& cfg, const std::string& path){
+    std::ifstream in(path);
+    if(!in)
+        throw std::invalid_argument("config: cannot open '" + path + "'");
+    std::string line;
+    for(int lineno = 1; std::getline(in, line); ++lineno){
+        line = trim(line.substr(0, line.find('#')));
+        if(line.empty()) continue;
+        size_t eq = line.find('=');
+        if(eq == std::string::npos)
+            throw std::invalid_argument("config: " + path + ":" + std::to_string(lineno) + ": expected key = value");
+        set_config_value(cfg, trim(line.substr(0, eq)), trim(line.substr(eq + 1)));
+    }
+}
+
+RunConfig load_config(int argc, char** argv){
+    RunConfig cfg;
+    std::vector<std::pair<std::string, std::string>> overrides;
+    for(int a = 1; a < argc; ++a){
+        std::string arg = argv[a];
+        if(arg.rfind("--", 0) == 0) arg = arg.substr(2);
+        size_t eq = arg.find('=');
+        if(eq == std::string::npos)
+            throw std::invalid_argument("config: expected --key=value, got '" + std::string(argv[a]) + "'");
+        std::string key = arg.substr(0, eq), value = arg.substr(eq + 1);
+        if(key == "config") load_config_file(cfg, value);   // file first, CLI wins
+        else overrides.emplace_back(key, value);
+    }
+    for(const auto& [key, value] : overrides)
+        set_config_value(cfg, key, value);
+
+    if(cfg.nx < 3 || cfg.ny < 3)
+        throw std::invalid_argument("config: nx and ny must be at least 3");
+    if(cfg.nz > 1){
+        const SolverOptions& o = cfg.solver;
+        if(cfg.init != "orszag_tang" || cfg.divergence_error > 0.0)
+            throw std::invalid_argument("config: 3-D runs (nz > 1) support init = orszag_tang only");
+        if(o.divb != DivBScheme::GLM || o.projection_every > 0 ||
+           o.diffusion != DiffusionScheme::Explicit || o.lts_levels > 1 || o.riemann != RiemannSolver::HLL || o.split)
+            throw std::invalid_argument("config: 3-D runs (nz > 1) need divb = glm, diffusion = explicit, riemann = hll, "
+                                        "no projection, LTS or split");
+        if(!cfg.outputs.empty())
+            throw std::invalid_argument("config: output streams are only available for 2-D runs");
+        if(cfg.tracers > 0)
+            throw std::invalid_argument("config: tracers are only available for 2-D runs");
+        if(cfg.autotune != Autotune::Off)
+            throw std::invalid_argument("config: autotune is only available for 2-D runs");
+    }
+    for(const OutputSpec& s : cfg.outputs)
+        if(s.x1 < 0.0 || s.x0 > cfg.Lx || s.y1 < 0.0 || s.y0 > cfg.Ly)
+            throw std::invalid_argument("config: region of output stream '" + s.name + "' lies outside the domain");
+    if(cfg.output_every < 1)
+        throw std::invalid_argument("config: output_every must be positive");
+    if(cfg.solver.activity_tile < 1)
+        throw std::invalid_argument("config: activity_tile must be positive");
+    if(!(cfg.solver.riemann_threshold >= 0.0))
+        throw std::invalid_argument("config: riemann_threshold must not be negative");
+    if(cfg.solver.split && (cfg.solver.divb == DivBScheme::CT || cfg.solver.lts_levels > 1 ||
+                            cfg.solver.activity_tol > 0.0 || cfg.solver.riemann == RiemannSolver::Hybrid))
+        throw std::invalid_argument("config: split does not combine with divb = ct, LTS, the activity mask "
+                                    "or riemann = hybrid");
+    if(cfg.snapshot_keyframe < 0)
+        throw std::invalid_argument("config: snapshot_keyframe must not be negative");
+    if(cfg.snapshot_bits < 1 || cfg.snapshot_bits > 52)
+        throw std::invalid_argument("config: snapshot_bits must be between 1 and 52");
+    if(cfg.tracers < 0 || cfg.tracer_every < 1 || cfg.tracer_sort < 0)
+        throw std::invalid_argument("config: tracers and tracer_sort must not be negative, tracer_every must be positive");
+    if(cfg.rollback_depth < 0 || cfg.rollback_every < 1 || !(cfg.rollback_cfl > 0.0 && cfg.rollback_cfl < 1.0))
+        throw std::invalid_argument("config: rollback_depth must not be negative, rollback_every must be positive "
+                                    "and rollback_cfl must lie in (0, 1)");
+    if(cfg.autotune_steps < 1)
+        throw std::invalid_argument("config: autotune_steps must be positive");
+    if(cfg.ooc_slab < 1)
+        throw std::invalid_argument("config: ooc_slab must be positive");
+    return cfg;
+}
+
+void print_config(const RunConfig& cfg, std::ostream& out){
+    out << "[Config] grid " << cfg.nx << "x" << cfg.ny;
+    if(cfg.nz > 1) out << "x" << cfg.nz;
+    out << " on " << cfg.Lx << "x" << cfg.Ly;
+    if(cfg.nz > 1) out << "x" << cfg.Lz;
+    out
+        << ", init=" << cfg.init << ", t_end=" << cfg.t_end << ", max_steps=" << cfg.max_steps
+        << ", output_every=" << cfg.output_every << " -> " << cfg.output_dir
+        << " (" << enum_name(cfg.output_format, output_format_names);
+    if(cfg.output_format != OutputFormat::CSV)
+        out << ", keyframe every " << cfg.snapshot_keyframe << ", " << cfg.snapshot_bits << " mantissa bits"
+            << (snapshot_compression_available() ? "" : ", stored raw: built without zlib");
+    out << ")\n";
+    for(const OutputSpec& s : cfg.outputs)
+        out << "[Config] output " << format_output_spec(s) << "\n";
+    if(cfg.tracers > 0)
+        out << "[Config] tracers=" << cfg.tracers << " tracer_every=" << cfg.tracer_every
+            << " tracer_sort=" << cfg.tracer_sort << "\n";
+    out << "[Config] nu=" << cfg.nu << " eta=" << cfg.physics.eta << " ch=" << cfg.physics.ch
+        << " cr=" << cfg.physics.cr << " gamma=" << cfg.physics.gamma << " cfl=" << cfg.solver.cfl << "\n";
+    out << "[Config] divb=" << enum_name(cfg.solver.divb, divb_names)
+        << " projection_every=" << cfg.solver.projection_every
+        << " diffusion=" << enum_name(cfg.solver.diffusion, diffusion_names)
+        << " lts_levels=" << cfg.solver.lts_levels
+        << " activity_tol=" << cfg.solver.activity_tol
+        << " riemann=" << enum_name(cfg.solver.riemann, riemann_names);
+    if(cfg.solver.riemann == RiemannSolver::Hybrid) out << " riemann_threshold=" << cfg.solver.riemann_threshold;
+    if(cfg.solver.split) out << " split=true split_transpose=" << (cfg.solver.split_transpose ? "true" : "false");
+    out
+        << " positivity=" << (cfg.solver.positivity ? "true" : "false") << " threads=" << cfg.threads
+        << " backend=" << enum_name(cfg.backend, backend_names)
+        << " huge_pages=" << enum_name(cfg.huge_pages, huge_page_names) << "\n";
+    if(cfg.autotune != Autotune::Off)
+        out << "[Config] autotune=" << enum_name(cfg.autotune, autotune_names) << " autotune_steps="
+            << cfg.autotune_steps << " autotune_cache="
+            << (cfg.autotune_cache.empty() ? autotune_default_cache() : cfg.autotune_cache) << "\n";
+    if(cfg.nz <= 1 && cfg.rollback_depth > 0)
+        out << "[Config] rollback_depth=" << cfg.rollback_depth << " rollback_every=" << cfg.rollback_every
+            << " rollback_cfl=" << cfg.rollback_cfl << "\n";
+    if(!cfg.out_of_core.empty())
+        out << "[Config] out_of_core=" << cfg.out_of_core << " ooc_slab=" << cfg.ooc_slab << "\n";
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "solver.hpp"
+#include "io.hpp"
+#include "autotune.hpp"
+#include "exec.hpp"
+
+// Everything a run needs. Defaults reproduce the original hard-coded setup;
+// values come from a "key = value" file (--config=FILE) and are then
+// overridden by --key=value command-line arguments.
+struct RunConfig {
+    // Grid. With nz > 1 the 3-D solver runs and nx, ny, nz count interior cells
+    int nx = 64, ny = 64, nz = 1;
+    double Lx = 1.0, Ly = 1.0, Lz = 1.0;
+    // Time
+    int max_steps = 2000;
+    double t_end = 20.0;
+    // Output
+    int output_every = 20;
+    std::string output_dir = "Result";
+    OutputFormat output_format = OutputFormat::CSV;   // csv | snapshots | both: full dumps as CSV files and/or one container
+    int snapshot_keyframe = 16;         // container: keyframe every N records, XOR deltas between (0 = raw)
+    int snapshot_bits = 52;             // container: mantissa bits kept in compressed records (52 = lossless)
+    std::vector<OutputSpec> outputs;    // extra streams, one "output = ..." line each (2-D runs)
+    int tracers = 0;                    // tracer particles (2-D runs), 0 = none
+    int tracer_every = 10;              // steps between trajectory frames
+    int tracer_sort = 20;               // steps between particle sorts by cell, 0 = never
+    // Problem
+    std::string init = "orszag_tang";   // orszag_tang | disk | blast | alfven (2.5-D build)
+    int seed = 12345;                   // disk noise seed (env SEED still overrides), tracer placement
+    double divergence_error = 0.0;      // > 0: add_divergence_error amplitude
+    // Physics
+    double nu = 0.01;
+    PhysicsParams physics;
+    // Solver (includes the CFL number)
+    SolverOptions solver;
+    int rollback_depth = 2;             // 2-D: checkpoints kept in memory for retrying unstable steps, 0 = off
+    int rollback_every = 50;            // steps between checkpoints
+    double rollback_cfl = 0.5;          // CFL factor per failed step; regained per clean checkpoint interval
+    int threads = 0;                    // threads, 0 = runtime default (OpenMP) or hardware threads (pool)
+    ExecBackend backend = ExecBackend::OpenMP;   // openmp | stdpar | pool: runs the parallel loops (exec.hpp)
+    Autotune autotune = Autotune::Off;  // off | on | refresh (2-D): tune threads, kernel and tile at startup
+    std::string autotune_cache;         // "" = per-host file under ~/.cache/mhd_solver, "none" = no cache
+    int autotune_steps = 3;             // timed steps per candidate
+    HugePages huge_pages = HugePages::Auto;   // off | thp | auto: backing of large field buffers
+    std::string out_of_core;            // file backing the state, "" = in memory
+    int ooc_slab = 8;                   // 3-D out-of-core paging unit, in x-planes
+};
+
+// Throws std::invalid_argument on unknown keys or malformed values
+RunConfig load_config(int argc, char** argv);
+void set_config_value(RunConfig& cfg, const std::string& key, const std::string& value);
+void load_config_file(RunConfig& cfg, const std::string& path);
+void print_config(const RunConfig& cfg, std::ostream& out);
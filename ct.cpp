@@ -0,0 +1,74 @@
+#include "ct.hpp"
+#include "stencil.hpp"
+#include <cmath>
+#include <algorithm>
+
+void ct_init_faces(FlowField& flow){
+    const int nx = flow.bx.nx, ny = flow.bx.ny;
+    exec::for_2d(0, nx-1, 0, ny-1, [&](int i, int j){
+        flow.bxf.data[i][j] = 0.5*(flow.bx.data[i][j] + flow.bx.data[i+1][j]);
+        flow.byf.data[i][j] = 0.5*(flow.by.data[i][j] + flow.by.data[i][j+1]);
+    });
+    ct_apply_face_bc(flow);
+}
+
+void ct_apply_face_bc(FlowField& flow){
+    const int nx = flow.bx.nx, ny = flow.bx.ny;
+    // Face k and face k+(n-2) are the same physical face. The normal faces on
+    // the seam are updated twice from different ghost EMFs, so copy one onto
+    // the other first, as the cell-centred periodic BC does.
+    exec::for_each(0, ny, [&](long j){
+        flow.bxf.data[0][j] = flow.bxf.data[nx-2][j];
+    });
+    exec::for_each(0, nx, [&](long i){
+        flow.byf.data[i][0] = flow.byf.data[i][ny-2];
+    });
+    exec::for_each(0, nx, [&](long i){
+        flow.bxf.data[i][0]    = flow.bxf.data[i][ny-2];
+        flow.bxf.data[i][ny-1] = flow.bxf.data[i][1];
+    });
+    exec::for_each(0, ny, [&](long j){
+        flow.byf.data[0][j]    = flow.byf.data[nx-2][j];
+        flow.byf.data[nx-1][j] = flow.byf.data[1][j];
+        flow.bxf.data[nx-1][j] = flow.bxf.data[1][j];
+    });
+    exec::for_each(0, nx, [&](long i){
+        flow.byf.data[i][ny-1] = flow.byf.data[i][1];
+    });
+}
+
+void ct_update_faces(FlowField& flow, const Grid& ez, double dt){
+    const int nx = flow.bx.nx, ny = flow.bx.ny;
+    const double dx = flow.bx.dx, dy = flow.bx.dy;
+
+    // dBx/dt = -dEz/dy
+    exec::for_2d(0, nx-1, 1, ny-1, [&](int i, int j){
+        flow.bxf.data[i][j] -= dt/dy * (ez.data[i][j] - ez.data[i][j-1]);
+    });
+
+    // dBy/dt = dEz/dx
+    exec::for_2d(1, nx-1, 0, ny-1, [&](int i, int j){
+        flow.byf.data[i][j] += dt/dx * (ez.data[i][j] - ez.data[i-1][j]);
+    });
+
+    ct_apply_face_bc(flow);
+}
+
+void ct_faces_to_cells(FlowField& flow){
+    const int nx = flow.bx.nx, ny = flow.bx.ny;
+    exec::for_2d(1, nx-1, 1, ny-1, [&](int i, int j){
+        flow.bx.data[i][j] = 0.5*(flow.bxf.data[i-1][j] + flow.bxf.data[i][j]);
+        flow.by.data[i][j] = 0.5*(flow.byf.data[i][j-1] + flow.byf.data[i][j]);
+    });
+}
+
+std::pair<double, double> compute_face_divergence_errors(const FlowField& flow){
+    const Grid& grid = flow.bxf;
+    auto [max_divB, L1_divB] = stencil::abs_max_sum(1, grid.nx-1, 1, grid.ny-1, [&](int i, int j){
+        return (flow.bxf.data[i][j] - flow.bxf.data[i-1][j]) / grid.dx
+             + (flow.byf.data[i][j] - flow.byf.data[i][j-1]) / grid.dy;
+    });
+
+    L1_divB /= (grid.nx-2) * (grid.ny-2);
+    return {max_divB, L1_divB};
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <utility>
+#include "grid.hpp"
+
+// Constrained transport helpers operating on the face-centred fields
+// FlowField::bxf / FlowField::byf.
+
+// Initialise face fields by averaging the cell-centred bx/by.
+void ct_init_faces(FlowField& flow);
+// Periodic ghost faces (bxf ghost rows, byf ghost columns).
+void ct_apply_face_bc(FlowField& flow);
+// Advance face fields with corner EMFs ez[i][j] located at (i+1/2, j+1/2).
+void ct_update_faces(FlowField& flow, const Grid& ez, double dt);
+// Cell-centred bx/by as the average of the two bounding faces (interior cells).
+void ct_faces_to_cells(FlowField& flow);
+// Max and L1 of the face-based div B, which CT keeps at round-off level.
+std::pair<double, double> compute_face_divergence_errors(const FlowField& flow);
@@ -0,0 +1,15 @@
+# Optional dependencies shared by compile.sh, bench.sh and build_python.sh.
+# Source it, then pass $ZLIB $FFTW $TBB to g++.
+
+# Snapshot compression uses zlib when it is installed
+if echo '#include <zlib.h>' | g++ -E -x c++ - >/dev/null 2>&1; then
+    ZLIB="-DMHD_USE_ZLIB -lz"
+fi
+# FFT projection cleaning uses FFTW when it is installed
+if echo '#include <fftw3.h>' | g++ -E -x c++ - >/dev/null 2>&1; then
+    FFTW="-DMHD_USE_FFTW -lfftw3"
+fi
+# backend=stdpar runs std::execution on TBB when libstdc++ finds its headers
+if echo '#include <tbb/tbb.h>' | g++ -E -x c++ - >/dev/null 2>&1; then
+    TBB="-ltbb"
+fi
@@ -0,0 +1,88 @@
+#include "diffusion.hpp"
+#include "multigrid.hpp"
+#include "exec.hpp"
+#include <cmath>
+#include <algorithm>
+
+double compute_diffusion_timestep(const Grid& g, double coeff){
+    if(coeff <= 0.0) return 1e10;
+    return 0.5 / (coeff * (1.0/(g.dx*g.dx) + 1.0/(g.dy*g.dy)));
+}
+
+static void apply_periodic_bc(Grid& g){
+    exec::for_each(0, g.ny, [&](long j){
+        g.data[0][j]      = g.data[g.nx-2][j];
+        g.data[g.nx-1][j] = g.data[1][j];
+    });
+    exec::for_each(0, g.nx, [&](long i){
+        g.data[i][0]      = g.data[i][g.ny-2];
+        g.data[i][g.ny-1] = g.data[i][1];
+    });
+}
+
+// out = coeff * lap(in) on interior cells
+static void diffusion_operator(const Grid& in, double coeff, Grid& out){
+    const double cx = coeff/(in.dx*in.dx), cy = coeff/(in.dy*in.dy);
+    exec::for_2d(1, in.nx-1, 1, in.ny-1, [&](int i, int j){
+        out.data[i][j] = cx*(in.data[i+1][j] - 2*in.data[i][j] + in.data[i-1][j])
+                       + cy*(in.data[i][j+1] - 2*in.data[i][j] + in.data[i][j-1]);
+    });
+}
+
+int diffuse_rkl2(const std::vector<DiffusedField>& fields, double dt){
+    double dt_expl = 1e10;
+    for(const auto& [g, coeff] : fields)
+        dt_expl = std::min(dt_expl, compute_diffusion_timestep(*g, coeff));
+    if(dt_expl >= 1e10) return 0;
+
+    // Smallest s with dt <= 0.9*dt_expl*(s^2+s-2)/4 (Meyer, Balsara & Aslam 2014)
+    double tau = dt / (0.9*dt_expl);
+    int s = std::max(2, (int)std::ceil(0.5*(-1.0 + std::sqrt(9.0 + 16.0*tau))));
+
+    auto b = [](int j){ return j < 2 ? 1.0/3.0 : (j*j + j - 2.0) / (2.0*j*(j + 1.0)); };
+    const double w1 = 4.0 / (s*s + s - 2.0);
+
+    for(const auto& [g, coeff] : fields){
+        if(coeff <= 0.0) continue;
+        Grid& y0 = *g;
+        Grid l0(y0.nx, y0.ny, y0.dx, y0.dy, y0.x0, y0.y0);
+        Grid lj = l0, yjm1 = y0, yjm2 = y0, yj = y0;
+
+        diffusion_operator(y0, coeff, l0);
+        // Stage updates run over the whole grid: l0 and lj are zero in the
+        // ghosts, which apply_periodic_bc then overwrites
+        const double mu1 = b(1)*w1;
+        yjm1 = y0 + mu1*dt*l0;
+        apply_periodic_bc(yjm1);
+
+        for(int j=2;j<=s;++j){
+            const double mu    = (2.0*j - 1.0)/j * b(j)/b(j-1);
+            const double nuj   = -(j - 1.0)/j * b(j)/b(j-2);
+            const double mut   = mu*w1;
+            const double gamt  = -(1.0 - b(j-1))*mut;
+            diffusion_operator(yjm1, coeff, lj);
+            yj = mu*yjm1 + nuj*yjm2 + (1.0 - mu - nuj)*y0 + mut*dt*lj + gamt*dt*l0;
+            apply_periodic_bc(yj);
+            std::swap(yjm2.data, yjm1.data);
+            std::swap(yjm1.data, yj.data);
+        }
+        y0.data = yjm1.data;
+    }
+    return s;
+}
+
+int diffuse_implicit(const std::vector<DiffusedField>& fields, double dt, double theta){
+    int cycles = 0;
+    for(const auto& [g, coeff] : fields){
+        if(coeff <= 0.0) continue;
+        Grid& f = *g;
+        Grid rhs = f;
+        if(theta < 1.0){
+            Grid lf(f.nx, f.ny, f.dx, f.dy, f.x0, f.y0);
+            diffusion_operator(f, coeff, lf);
+            rhs += (1.0 - theta)*dt*lf;   // lf is zero in the ghosts
+        }
+        cycles += mg_solve_helmholtz(f, rhs, theta*dt*coeff);
+    }
+    return cycles;
+}
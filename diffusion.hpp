@@ -0,0 +1,19 @@
+#pragma once
+#include <utility>
+#include <vector>
+#include "grid.hpp"
+
+// A field diffused as d(f)/dt = coeff * lap(f) on the periodic interior
+using DiffusedField = std::pair<Grid*, double>;
+
+// Largest stable forward-Euler step for coeff * lap on grid g
+double compute_diffusion_timestep(const Grid& g, double coeff);
+
+// Operator-split Runge-Kutta-Legendre (RKL2) super-time-step of length dt.
+// The stage count is chosen from dt and the explicit limit; returns it.
+int diffuse_rkl2(const std::vector<DiffusedField>& fields, double dt);
+
+// Implicit theta-scheme step (theta = 1 backward Euler, 0.5 Crank-Nicolson):
+// (I - theta*dt*c*lap) f_new = (I + (1-theta)*dt*c*lap) f, solved with
+// geometric multigrid. Returns the total number of V-cycles.
+int diffuse_implicit(const std::vector<DiffusedField>& fields, double dt, double theta);
@@ -0,0 +1,147 @@
+#include "exec.hpp"
+#include <omp.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+inline void cpu_relax(){
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Spins before a waiting worker goes to sleep: long enough to bridge the gap
+// between the loops of one solver step, short enough not to burn a core
+// through output or setup
+constexpr int kSpins = 1 << 16;
+
+thread_local bool in_pool = false;
+
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads) : size_(std::max(threads, 1)) {
+        for (int w = 1; w < size_; ++w) workers_.emplace_back([this, w]{ work(w); });
+    }
+    ~ThreadPool(){
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+            generation_.fetch_add(1, std::memory_order_release);
+        }
+        wake_.notify_all();
+        for (std::thread& t : workers_) t.join();
+    }
+
+    int size() const { return size_; }
+
+    void run(void (*fn)(void*, int, int), void* ctx){
+        if (size_ == 1 || in_pool) { fn(ctx, 0, 1); return; }
+        fn_ = fn;
+        ctx_ = ctx;
+        pending_.store(size_ - 1, std::memory_order_relaxed);
+        {
+            // Sleeping workers check the generation under the lock, so none misses it
+            std::lock_guard<std::mutex> lock(mutex_);
+            generation_.fetch_add(1, std::memory_order_release);
+        }
+        if (sleepers_.load(std::memory_order_acquire) > 0) wake_.notify_all();
+        in_pool = true;
+        fn(ctx, 0, size_);
+        in_pool = false;
+        // Barrier: wait for the other workers' parts
+        for (int s = 0; pending_.load(std::memory_order_acquire) > 0; ++s)
+            if (s < kSpins) cpu_relax(); else std::this_thread::yield();
+    }
+
+private:
+    void work(int w){
+        in_pool = true;
+        unsigned seen = 0;
+        for (;;) {
+            unsigned g;
+            int s = 0;
+            while ((g = generation_.load(std::memory_order_acquire)) == seen && s < kSpins) { cpu_relax(); ++s; }
+            if (g == seen) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                sleepers_.fetch_add(1, std::memory_order_acq_rel);
+                wake_.wait(lock, [&]{ return generation_.load(std::memory_order_acquire) != seen; });
+                sleepers_.fetch_sub(1, std::memory_order_acq_rel);
+                g = generation_.load(std::memory_order_acquire);
+            }
+            seen = g;
+            if (stop_) return;
+            fn_(ctx_, w, size_);
+            pending_.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    const int size_;
+    std::vector<std::thread> workers_;
+    void (*fn_)(void*, int, int) = nullptr;
+    void* ctx_ = nullptr;
+    std::atomic<unsigned> generation_{0};
+    std::atomic<int> pending_{0};
+    std::atomic<int> sleepers_{0};
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+};
+
+std::unique_ptr<ThreadPool> pool;
+int pool_threads = 0;   // requested size, 0 = hardware threads
+
+ThreadPool& get_pool(){
+    if (!pool) {
+        int n = pool_threads > 0 ? pool_threads : (int)std::thread::hardware_concurrency();
+        pool = std::make_unique<ThreadPool>(n);
+    }
+    return *pool;
+}
+
+} // namespace
+
+namespace exec::detail {
+
+ExecBackend backend = ExecBackend::OpenMP;
+
+void pool_run(void (*fn)(void*, int, int), void* ctx){ get_pool().run(fn, ctx); }
+
+int pool_size(){ return get_pool().size(); }
+
+long stdpar_parts(long n){
+    const long threads = std::max(1u, std::thread::hardware_concurrency());
+    return std::max(1L, std::min(n, 4 * threads));
+}
+
+} // namespace exec::detail
+
+void set_exec_backend(ExecBackend backend, int threads){
+    exec::detail::backend = backend;
+    set_exec_threads(threads);
+}
+
+ExecBackend get_exec_backend(){ return exec::detail::backend; }
+
+void set_exec_threads(int threads){
+    if (threads > 0) omp_set_num_threads(threads);
+    if (threads != pool_threads) {
+        pool_threads = threads;
+        pool.reset();   // rebuilt at the next pool loop
+    }
+}
+
+int exec_threads(){
+    switch (exec::detail::backend) {
+    case ExecBackend::OpenMP: return omp_get_max_threads();
+    case ExecBackend::Pool:   return exec::detail::pool_size();
+    default:                  return (int)std::max(1u, std::thread::hardware_concurrency());
+    }
+}
@@ -0,0 +1,213 @@
+#pragma once
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+#if __has_include(<execution>)
+#include <execution>
+#define MHD_HAVE_STD_EXECUTION 1
+#endif
+
+// Execution backends for the parallel loops of the solvers, the stencil and
+// field-expression headers and the modules they call:
+//  - OpenMP:  the loops as OpenMP worksharing constructs (the default);
+//  - StdPar:  std::execution::par_unseq algorithms. libstdc++ runs them on
+//             TBB when its headers are found at build time (the build
+//             scripts then link -ltbb), and serially otherwise;
+//  - Pool:    a persistent pool of std::threads. The caller takes part as
+//             worker 0, and a spin barrier ends each loop; idle workers
+//             spin briefly, then sleep until the next loop.
+// Every backend splits the same loops into disjoint parts, and the
+// reductions used (min, max, integer counts) do not depend on the order, so
+// all backends give the same results; only floating-point sums differ with
+// the thread count, as with OpenMP. Loops outside this header use OpenMP
+// only for simd.
+enum class ExecBackend { OpenMP, StdPar, Pool };
+
+// threads > 0 sets the OpenMP thread count and the pool size; 0 keeps the
+// OpenMP default and sizes the pool to the hardware threads
+void set_exec_backend(ExecBackend backend, int threads = 0);
+ExecBackend get_exec_backend();
+// Threads a parallel loop runs on with the current backend
+int exec_threads();
+// Changes the thread count of the current backend (no effect on StdPar)
+void set_exec_threads(int threads);
+
+namespace exec {
+
+enum class Schedule { Static, Dynamic };
+
+namespace detail {
+
+extern ExecBackend backend;
+
+// Runs fn(ctx, worker, workers) on every pool worker and returns when all
+// are done. Called from inside a pool loop it runs fn(ctx, 0, 1) inline.
+void pool_run(void (*fn)(void*, int, int), void* ctx);
+int pool_size();
+
+template <class F>
+void pool_for(F& f){
+    pool_run([](void* ctx, int w, int n){ (*static_cast<F*>(ctx))(w, n); }, &f);
+}
+
+inline std::pair<long, long> chunk(long begin, long end, int w, int n){
+    const long len = end - begin;
+    return {begin + len * w / n, begin + len * (w + 1) / n};
+}
+
+// Random-access iterator over the integers, for the std::execution algorithms
+struct Counter {
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = long;
+    using difference_type = long;
+    using pointer = const long*;
+    using reference = long;
+    long k = 0;
+    long operator*() const { return k; }
+    long operator[](long d) const { return k + d; }
+    Counter& operator++(){ ++k; return *this; }
+    Counter operator++(int){ Counter c = *this; ++k; return c; }
+    Counter& operator--(){ --k; return *this; }
+    Counter operator--(int){ Counter c = *this; --k; return c; }
+    Counter& operator+=(long d){ k += d; return *this; }
+    Counter& operator-=(long d){ k -= d; return *this; }
+    friend Counter operator+(Counter c, long d){ c.k += d; return c; }
+    friend Counter operator+(long d, Counter c){ c.k += d; return c; }
+    friend Counter operator-(Counter c, long d){ c.k -= d; return c; }
+    friend long operator-(const Counter& a, const Counter& b){ return a.k - b.k; }
+    friend bool operator==(const Counter& a, const Counter& b){ return a.k == b.k; }
+    friend bool operator!=(const Counter& a, const Counter& b){ return a.k != b.k; }
+    friend bool operator<(const Counter& a, const Counter& b){ return a.k < b.k; }
+    friend bool operator>(const Counter& a, const Counter& b){ return a.k > b.k; }
+    friend bool operator<=(const Counter& a, const Counter& b){ return a.k <= b.k; }
+    friend bool operator>=(const Counter& a, const Counter& b){ return a.k >= b.k; }
+};
+
+// Parts a StdPar loop over n items is cut into
+long stdpar_parts(long n);
+
+} // namespace detail
+
+// f(b, e) on disjoint blocks [b, e) covering [begin, end), one per thread
+// (OpenMP, Pool) or a few per thread (StdPar); the caller vectorises inside
+template <class F>
+inline void for_blocks(long begin, long end, F&& f){
+    if (end <= begin) return;
+    switch (detail::backend) {
+    case ExecBackend::OpenMP:
+        #pragma omp parallel
+        {
+            auto [b, e] = detail::chunk(begin, end, omp_get_thread_num(), omp_get_num_threads());
+            if (b < e) f(b, e);
+        }
+        return;
+#ifdef MHD_HAVE_STD_EXECUTION
+    case ExecBackend::StdPar: {
+        const long parts = detail::stdpar_parts(end - begin);
+        std::for_each(std::execution::par_unseq, detail::Counter{0}, detail::Counter{parts}, [&](long p){
+            auto [b, e] = detail::chunk(begin, end, (int)p, (int)parts);
+            if (b < e) f(b, e);
+        });
+        return;
+    }
+#endif
+    default: {
+        auto body = [&](int w, int n){
+            auto [b, e] = detail::chunk(begin, end, w, n);
+            if (b < e) f(b, e);
+        };
+        detail::pool_for(body);
+    }
+    }
+}
+
+// f(k) for k in [begin, end)
+template <Schedule S = Schedule::Static, class F>
+inline void for_each(long begin, long end, F&& f){
+    if (S == Schedule::Dynamic && detail::backend == ExecBackend::OpenMP) {
+        #pragma omp parallel for schedule(dynamic)
+        for (long k = begin; k < end; ++k) f(k);
+        return;
+    }
+    if (S == Schedule::Dynamic && detail::backend == ExecBackend::Pool) {
+        std::atomic<long> next{begin};
+        auto body = [&](int, int){
+            for (long k; (k = next.fetch_add(1, std::memory_order_relaxed)) < end; ) f(k);
+        };
+        detail::pool_for(body);
+        return;
+    }
+    for_blocks(begin, end, [&](long b, long e){ for (long k = b; k < e; ++k) f(k); });
+}
+
+// f(i, j) over [i0, i1) x [j0, j1). OpenMP shares the collapsed index space
+// among the threads; the other backends split the rows.
+template <Schedule S = Schedule::Static, class F>
+inline void for_2d(int i0, int i1, int j0, int j1, F&& f){
+    if (detail::backend == ExecBackend::OpenMP) {
+        if (S == Schedule::Dynamic) {
+            #pragma omp parallel for collapse(2) schedule(dynamic)
+            for (int i = i0; i < i1; ++i)
+                for (int j = j0; j < j1; ++j) f(i, j);
+        } else {
+            #pragma omp parallel for collapse(2)
+            for (int i = i0; i < i1; ++i)
+                for (int j = j0; j < j1; ++j) f(i, j);
+        }
+        return;
+    }
+    for_each<S>(i0, i1, [&](long i){
+        for (int j = j0; j < j1; ++j) f((int)i, j);
+    });
+}
+
+// op-reduction of f(i, j) over [i0, i1) x [j0, j1); identity must be the
+// identity of op
+template <class T, class Op, class F>
+inline T reduce_2d(int i0, int i1, int j0, int j1, T identity, Op op, F&& f){
+    if (i1 <= i0 || j1 <= j0) return identity;
+    switch (detail::backend) {
+    case ExecBackend::OpenMP: {
+        T result = identity;
+        #pragma omp parallel
+        {
+            T local = identity;
+            #pragma omp for collapse(2) nowait
+            for (int i = i0; i < i1; ++i)
+                for (int j = j0; j < j1; ++j) local = op(local, f(i, j));
+            #pragma omp critical
+            result = op(result, local);
+        }
+        return result;
+    }
+#ifdef MHD_HAVE_STD_EXECUTION
+    case ExecBackend::StdPar:
+        return std::transform_reduce(std::execution::par_unseq, detail::Counter{i0}, detail::Counter{i1},
+                                     identity, op, [&](long i){
+            T local = identity;
+            for (int j = j0; j < j1; ++j) local = op(local, f((int)i, j));
+            return local;
+        });
+#endif
+    default: {
+        std::vector<T> partial(detail::pool_size(), identity);
+        auto body = [&](int w, int n){
+            auto [b, e] = detail::chunk(i0, i1, w, n);
+            T local = identity;
+            for (long i = b; i < e; ++i)
+                for (int j = j0; j < j1; ++j) local = op(local, f((int)i, j));
+            partial[w] = local;
+        };
+        detail::pool_for(body);
+        T result = identity;
+        for (const T& p : partial) result = op(result, p);
+        return result;
+    }
+    }
+}
+
+} // namespace exec
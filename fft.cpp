@@ -0,0 +1,96 @@
+#include "fft.hpp"
+#include "exec.hpp"
+#include <cmath>
+#include <algorithm>
+#ifdef MHD_USE_FFTW
+#include <fftw3.h>
+#endif
+
+static bool is_pow2(int n){ return n > 0 && (n & (n-1)) == 0; }
+
+// Iterative Cooley-Tukey, n a power of two
+static void fft_radix2(cplx* a, int n, bool inverse){
+    for(int i=1, j=0; i<n; ++i){
+        int bit = n >> 1;
+        for(; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if(i < j) std::swap(a[i], a[j]);
+    }
+    for(int len=2; len<=n; len<<=1){
+        double ang = 2.0*M_PI/len * (inverse ? 1.0 : -1.0);
+        cplx wlen(std::cos(ang), std::sin(ang));
+        for(int i=0; i<n; i+=len){
+            cplx w(1.0, 0.0);
+            for(int k=0; k<len/2; ++k){
+                cplx t = a[i+k+len/2] * w;
+                a[i+k+len/2] = a[i+k] - t;
+                a[i+k] += t;
+                w *= wlen;
+            }
+        }
+    }
+}
+
+// Bluestein chirp-z: arbitrary n as a power-of-two circular convolution
+static void fft_bluestein(cplx* a, int n, bool inverse){
+    int m = 1;
+    while(m < 2*n-1) m <<= 1;
+
+    // Per-thread scratch and chirp, rebuilt only when n changes
+    thread_local std::vector<cplx> w, b, x;
+    thread_local int cached_n = 0;
+    thread_local bool cached_inv = false;
+    if(cached_n != n || cached_inv != inverse || (int)b.size() != m){
+        w.assign(n, cplx());
+        b.assign(m, cplx());
+        for(long k=0; k<n; ++k){
+            double ang = M_PI * double((k*k) % (2L*n)) / n * (inverse ? 1.0 : -1.0);
+            w[k] = cplx(std::cos(ang), std::sin(ang));
+        }
+        b[0] = std::conj(w[0]);
+        for(int k=1; k<n; ++k) b[k] = b[m-k] = std::conj(w[k]);
+        fft_radix2(b.data(), m, false);
+        cached_n = n;
+        cached_inv = inverse;
+    }
+
+    x.assign(m, cplx());
+    for(int k=0; k<n; ++k) x[k] = a[k] * w[k];
+    fft_radix2(x.data(), m, false);
+    for(int k=0; k<m; ++k) x[k] *= b[k];
+    fft_radix2(x.data(), m, true);
+    for(int k=0; k<n; ++k) a[k] = x[k] * w[k] / double(m);
+}
+
+void fft_1d(cplx* a, int n, bool inverse){
+    if(is_pow2(n)) fft_radix2(a, n, inverse);
+    else           fft_bluestein(a, n, inverse);
+    if(inverse)
+        for(int k=0; k<n; ++k) a[k] /= double(n);
+}
+
+void fft_2d(std::vector<cplx>& a, int nx, int ny, bool inverse){
+#ifdef MHD_USE_FFTW
+    fftw_complex* p = reinterpret_cast<fftw_complex*>(a.data());
+    fftw_plan plan = fftw_plan_dft_2d(nx, ny, p, p, inverse ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_ESTIMATE);
+    fftw_execute(plan);
+    fftw_destroy_plan(plan);
+    if(inverse)
+        for(auto& c : a) c /= double(nx) * ny;
+#else
+    // Rows are contiguous
+    exec::for_each(0, nx, [&](long i){
+        fft_1d(&a[(size_t)i*ny], ny, inverse);
+    });
+
+    // Columns through a per-block gather buffer
+    exec::for_blocks(0, ny, [&](long jb, long je){
+        std::vector<cplx> col(nx);
+        for(long j=jb; j<je; ++j){
+            for(int i=0; i<nx; ++i) col[i] = a[(size_t)i*ny + j];
+            fft_1d(col.data(), nx, inverse);
+            for(int i=0; i<nx; ++i) a[(size_t)i*ny + j] = col[i];
+        }
+    });
+#endif
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <complex>
+#include <vector>
+
+using cplx = std::complex<double>;
+
+// In-place 1-D DFT of length n (unnormalised; the inverse divides by n).
+// Radix-2 for powers of two, Bluestein's algorithm otherwise.
+void fft_1d(cplx* a, int n, bool inverse);
+
+// In-place 2-D DFT of a row-major nx*ny array, parallel over rows then columns.
+// Uses FFTW when built with -DMHD_USE_FFTW.
+void fft_2d(std::vector<cplx>& a, int nx, int ny, bool inverse);
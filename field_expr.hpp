@@ -0,0 +1,148 @@
+#pragma once
+// Expression templates for whole-Grid arithmetic. An expression such as
+//   flow.e = flow.p/(gamma - 1.0) + 0.5*flow.rho*(flow.u*flow.u + flow.v*flow.v);
+// builds a tree of lightweight nodes and is evaluated only on assignment, in
+// one parallel (exec.hpp) SIMD pass over the contiguous storage, ghosts included. There
+// are no temporaries and each element is computed with the operations in the
+// order they are written, so results match the equivalent hand-written loop.
+// Included at the end of grid.hpp.
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include "exec.hpp"
+
+namespace expr {
+
+struct ExprBase {};
+
+template <class E>
+struct Expr : ExprBase {
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+// A Grid operand
+struct Leaf : Expr<Leaf> {
+    const double* p;
+    size_t n;
+    explicit Leaf(const Grid& g) : p(g.data.ptr()), n(g.data.size()) {}
+    double operator[](size_t k) const { return p[k]; }
+    size_t size() const { return n; }
+};
+
+// A scalar operand, broadcast over the grid
+struct Scalar : Expr<Scalar> {
+    double v;
+    explicit Scalar(double v_) : v(v_) {}
+    double operator[](size_t) const { return v; }
+    size_t size() const { return 0; }
+};
+
+template <class Op, class A>
+struct Unary : Expr<Unary<Op, A>> {
+    A a;
+    explicit Unary(const A& a_) : a(a_) {}
+    double operator[](size_t k) const { return Op::apply(a[k]); }
+    size_t size() const { return a.size(); }
+};
+
+template <class Op, class L, class R>
+struct Binary : Expr<Binary<Op, L, R>> {
+    L l;
+    R r;
+    Binary(const L& l_, const R& r_) : l(l_), r(r_) {}
+    double operator[](size_t k) const { return Op::apply(l[k], r[k]); }
+    size_t size() const {
+        if (l.size() && r.size() && l.size() != r.size())
+            throw std::invalid_argument("field expression: grids of different size");
+        return l.size() ? l.size() : r.size();
+    }
+};
+
+struct Add { static double apply(double a, double b) { return a + b; } };
+struct Sub { static double apply(double a, double b) { return a - b; } };
+struct Mul { static double apply(double a, double b) { return a * b; } };
+struct Div { static double apply(double a, double b) { return a / b; } };
+struct Max { static double apply(double a, double b) { return (a < b) ? b : a; } };   // as std::max
+struct Min { static double apply(double a, double b) { return (b < a) ? b : a; } };   // as std::min
+struct Neg  { static double apply(double a) { return -a; } };
+struct Sqrt { static double apply(double a) { return std::sqrt(a); } };
+struct Abs  { static double apply(double a) { return std::abs(a); } };
+
+// Operand type of a Grid, scalar or expression
+template <class T, class = void> struct node { };
+template <> struct node<Grid> { using type = Leaf; };
+template <class T> struct node<T, std::enable_if_t<std::is_arithmetic_v<T>>> { using type = Scalar; };
+template <class T> struct node<T, std::enable_if_t<std::is_base_of_v<ExprBase, T>>> { using type = T; };
+template <class T> using node_t = typename node<T>::type;
+
+template <class T>
+constexpr bool is_field = std::is_same_v<T, Grid> || std::is_base_of_v<ExprBase, T>;
+
+inline Leaf as_node(const Grid& g) { return Leaf(g); }
+template <class T, std::enable_if_t<std::is_arithmetic_v<T>, int> = 0>
+inline Scalar as_node(T v) { return Scalar((double)v); }
+template <class E>
+inline const E& as_node(const Expr<E>& e) { return e.self(); }
+
+// At least one field operand, the other a field or a scalar
+template <class L, class R>
+using enable_binary = std::enable_if_t<(is_field<L> || is_field<R>) &&
+                                       (is_field<L> || std::is_arithmetic_v<L>) &&
+                                       (is_field<R> || std::is_arithmetic_v<R>), int>;
+template <class A>
+using enable_unary = std::enable_if_t<is_field<A>, int>;
+
+template <class Op, class L, class R>
+inline Binary<Op, node_t<L>, node_t<R>> make_binary(const L& l, const R& r) {
+    return {as_node(l), as_node(r)};
+}
+
+} // namespace expr
+
+#define MHD_FIELD_BINARY(op, Op)                                          \
+    template <class L, class R, expr::enable_binary<L, R> = 0>            \
+    inline auto op(const L& l, const R& r) { return expr::make_binary<expr::Op>(l, r); }
+MHD_FIELD_BINARY(operator+, Add)
+MHD_FIELD_BINARY(operator-, Sub)
+MHD_FIELD_BINARY(operator*, Mul)
+MHD_FIELD_BINARY(operator/, Div)
+MHD_FIELD_BINARY(max, Max)
+MHD_FIELD_BINARY(min, Min)
+#undef MHD_FIELD_BINARY
+
+#define MHD_FIELD_UNARY(op, Op)                                           \
+    template <class A, expr::enable_unary<A> = 0>                         \
+    inline auto op(const A& a) { return expr::Unary<expr::Op, expr::node_t<A>>(expr::as_node(a)); }
+MHD_FIELD_UNARY(operator-, Neg)
+MHD_FIELD_UNARY(sqrt, Sqrt)
+MHD_FIELD_UNARY(abs, Abs)
+#undef MHD_FIELD_UNARY
+
+template <class E>
+Grid& Grid::operator=(const expr::Expr<E>& x) {
+    const E e = x.self();   // local copy: lets the compiler keep the operands in registers
+    if (e.size() && e.size() != data.size())
+        throw std::invalid_argument("field expression: grids of different size");
+    double* out = data.ptr();
+    const size_t n = data.size();
+    exec::for_blocks(0, (long)n, [&](long b, long end){
+        #pragma omp simd
+        for (long k = b; k < end; ++k) out[k] = e[k];
+    });
+    return *this;
+}
+
+template <class E>
+Grid& Grid::operator+=(const expr::Expr<E>& x) {
+    const E e = x.self();   // local copy: lets the compiler keep the operands in registers
+    if (e.size() && e.size() != data.size())
+        throw std::invalid_argument("field expression: grids of different size");
+    double* out = data.ptr();
+    const size_t n = data.size();
+    exec::for_blocks(0, (long)n, [&](long b, long end){
+        #pragma omp simd
+        for (long k = b; k < end; ++k) out[k] += e[k];
+    });
+    return *this;
+}
@@ -1,28 +1,124 @@
 #include "grid.hpp"
 #include <algorithm>
-#include <omp.h>
+#include "exec.hpp"
 #include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+struct BackingFile {
+    std::string path;
+    int fd = -1;
+
+    BackingFile(const std::string& p, size_t bytes) : path(p) {
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if(fd < 0 || ftruncate(fd, (off_t)bytes) != 0)
+            fail("cannot create");
+    }
+    ~BackingFile(){
+        if(fd >= 0){ close(fd); unlink(path.c_str()); }
+    }
+    [[noreturn]] void fail(const char* what){
+        std::string msg = std::string("FlowField: ") + what + " backing file '" + path + "': " + std::strerror(errno);
+        if(fd >= 0){ close(fd); unlink(path.c_str()); }
+        fd = -1;
+        throw std::runtime_error(msg);
+    }
+};
+
+Array2D::Array2D(int rows, int cols, std::shared_ptr<BackingFile> file, size_t offset)
+    : rows_(rows), cols_(cols), file_(std::move(file)), map_len_(size() * sizeof(double))
+{
+    void* addr = mmap(nullptr, map_len_, PROT_READ | PROT_WRITE, MAP_SHARED, file_->fd, (off_t)offset);
+    if(addr == MAP_FAILED) file_->fail("cannot map");
+    map_ = addr;
+    data_ = static_cast<double*>(addr);
+}
+
+Array2D::Array2D(const Array2D& o)
+    : rows_(o.rows_), cols_(o.cols_), buf_(o.data_, o.data_ + o.size()), data_(buf_.data()) {}
+
+Array2D& Array2D::operator=(const Array2D& o){
+    if(this == &o) return *this;
+    if(rows_ == o.rows_ && cols_ == o.cols_){
+        std::copy(o.data_, o.data_ + o.size(), data_);
+        return *this;
+    }
+    Array2D t(o);
+    swap(t);
+    return *this;
+}
+
+Array2D::~Array2D(){
+    if(map_) munmap(map_, map_len_);
+}
+
+void Array2D::swap(Array2D& o) noexcept {
+    std::swap(rows_, o.rows_);
+    std::swap(cols_, o.cols_);
+    buf_.swap(o.buf_);
+    file_.swap(o.file_);
+    std::swap(map_, o.map_);
+    std::swap(map_len_, o.map_len_);
+    std::swap(data_, o.data_);
+}
 
 Grid::Grid(int nx_,int ny_,double dx_,double dy_,double x0_,double y0_)
     : nx(nx_),ny(ny_),dx(dx_),dy(dy_),x0(x0_),y0(y0_),
-      data(nx_, std::vector<double>(ny_,0.0))
+      data(nx_, ny_, 0.0)
 {
     if(nx_ < 3 || ny_ < 3)
         throw std::invalid_argument("Grid size must be at least 3x3");
 }
 
+Grid::Grid(Array2D data_,double dx_,double dy_,double x0_,double y0_)
+    : nx(data_.rows()),ny(data_.cols()),dx(dx_),dy(dy_),x0(x0_),y0(y0_),
+      data(std::move(data_))
+{
+    if(nx < 3 || ny < 3)
+        throw std::invalid_argument("Grid size must be at least 3x3");
+}
+
 void Grid::fill(double v){
-#pragma omp parallel for collapse(2)
-    for(int i=0;i<nx;++i)
-        for(int j=0;j<ny;++j)
-            data[i][j]=v;
+    exec::for_2d(0, nx, 0, ny, [&](int i, int j){ data[i][j]=v; });
+}
+
+
+#ifdef MHD_2P5D
+static constexpr int kFlowFields = 12;
+#else
+static constexpr int kFlowFields = 10;
+#endif
+
+// Bytes of one field in a backing file, rounded up to whole pages so that
+// each field maps its own slice
+static size_t field_stride(int nx, int ny){
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return ((size_t)nx*ny*sizeof(double) + page - 1) / page * page;
+}
+
+// Storage of field k: in memory, or slice k of the file (a fresh file reads as zeros)
+static Array2D field_storage(int nx, int ny, const std::shared_ptr<BackingFile>& file, int k){
+    if(!file) return Array2D(nx, ny, 0.0);
+    return Array2D(nx, ny, file, (size_t)k * field_stride(nx, ny));
 }
 
+FlowField::FlowField(int nx,int ny,double dx,double dy,double x0,double y0,const std::string& backing_file)
+    : FlowField(nx,ny,dx,dy,x0,y0,
+                backing_file.empty() || nx < 3 || ny < 3 ? nullptr
+                : std::make_shared<BackingFile>(backing_file, kFlowFields * field_stride(nx,ny))) {}
 
-FlowField::FlowField(int nx,int ny,double dx,double dy,double x0,double y0)
-    : rho(nx,ny,dx,dy,x0,y0), u(nx,ny,dx,dy,x0,y0), v(nx,ny,dx,dy,x0,y0),
-      p(nx,ny,dx,dy,x0,y0), e(nx,ny,dx,dy,x0,y0),
-      bx(nx,ny,dx,dy,x0,y0), by(nx,ny,dx,dy,x0,y0), psi(nx,ny,dx,dy,x0,y0)
+FlowField::FlowField(int nx,int ny,double dx,double dy,double x0,double y0,std::shared_ptr<BackingFile> file)
+    : rho(field_storage(nx,ny,file,0),dx,dy,x0,y0), u(field_storage(nx,ny,file,1),dx,dy,x0,y0),
+      v(field_storage(nx,ny,file,2),dx,dy,x0,y0), p(field_storage(nx,ny,file,3),dx,dy,x0,y0),
+      e(field_storage(nx,ny,file,4),dx,dy,x0,y0), bx(field_storage(nx,ny,file,5),dx,dy,x0,y0),
+      by(field_storage(nx,ny,file,6),dx,dy,x0,y0), psi(field_storage(nx,ny,file,7),dx,dy,x0,y0),
+      bxf(field_storage(nx,ny,file,8),dx,dy,x0,y0), byf(field_storage(nx,ny,file,9),dx,dy,x0,y0)
+#ifdef MHD_2P5D
+      , w(field_storage(nx,ny,file,10),dx,dy,x0,y0), bz(field_storage(nx,ny,file,11),dx,dy,x0,y0)
+#endif
 {
     if(nx < 3 || ny < 3)
         throw std::invalid_argument("FlowField grid must be at least 3x3");
@@ -1,10 +1,57 @@
 #pragma once
 #include <vector>
 #include <cmath>
+#include <memory>
 #include <string>
 #include <stdexcept>
+#include "hugepage.hpp"
 
 
+struct BackingFile;
+
+/**
+ * Contiguous row-major rows x cols storage; a[i][j] indexing as with nested vectors.
+ * Buffers of 2 MB or more are backed by huge pages where available (hugepage.hpp).
+ * An array may instead live in a memory-mapped slice of a backing file
+ * (out-of-core). Copies are always in memory; assigning to an array of the
+ * same shape writes into its existing storage, file or not.
+ */
+class Array2D {
+public:
+    Array2D() = default;
+    Array2D(int rows, int cols, double v = 0.0)
+        : rows_(rows), cols_(cols), buf_((size_t)rows*cols, v), data_(buf_.data()) {}
+    // Bytes [offset, offset + rows*cols*8) of file; offset must be page aligned
+    Array2D(int rows, int cols, std::shared_ptr<BackingFile> file, size_t offset);
+    Array2D(const Array2D& o);
+    Array2D(Array2D&& o) noexcept { swap(o); }
+    Array2D& operator=(const Array2D& o);
+    Array2D& operator=(Array2D&& o) noexcept { Array2D t(std::move(o)); swap(t); return *this; }
+    ~Array2D();
+
+    double*       operator[](int i)       { return data_ + (size_t)i*cols_; }
+    const double* operator[](int i) const { return data_ + (size_t)i*cols_; }
+
+    double*       ptr()       { return data_; }
+    const double* ptr() const { return data_; }
+    size_t size() const { return (size_t)rows_*cols_; }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    bool file_backed() const { return map_ != nullptr; }
+
+private:
+    void swap(Array2D& o) noexcept;
+
+    int rows_ = 0, cols_ = 0;
+    std::vector<double, HugePageAllocator<double>> buf_;   // in-memory storage
+    std::shared_ptr<BackingFile> file_;                    // out-of-core storage: the file,
+    void* map_ = nullptr;                                  // its mapped slice
+    size_t map_len_ = 0;
+    double* data_ = nullptr;
+};
+
+namespace expr { template <class E> struct Expr; }
+
 /**
  * Lightweight 2‑D uniformly‑spaced scalar field.
  */
@@ -13,16 +60,40 @@ public:
     int nx, ny;
     double dx, dy;
     double x0, y0;
-    std::vector<std::vector<double>> data;
+    Array2D data;
 
     Grid(int nx, int ny, double dx, double dy, double x0=0.0, double y0=0.0);
+    // Over existing storage, nx x ny = data.rows() x data.cols()
+    Grid(Array2D data, double dx, double dy, double x0=0.0, double y0=0.0);
     void fill(double v);
+
+    // Fused whole-grid evaluation of a field expression (field_expr.hpp)
+    template <class E> Grid& operator=(const expr::Expr<E>& e);
+    template <class E> Grid& operator+=(const expr::Expr<E>& e);
 };
 
 
+// Build with -DMHD_2P5D for 2.5-D MHD: FlowField then also carries the
+// out-of-plane velocity w and field bz (functions of x and y only). The
+// default build neither stores nor touches them.
+//
+// With a backing file the fields live in that file, memory-mapped, instead of
+// in RAM (out-of-core); the file is created, sized, and removed again when the
+// last field using it is destroyed. Copies of the state are in memory.
 struct FlowField {
     Grid rho,u,v,p,e;
     Grid bx,by,psi;
-    FlowField(int nx,int ny,double dx,double dy,double x0=0.0,double y0=0.0);
+    Grid bxf,byf;   // face-centred B for constrained transport: bxf[i][j] at x-face i+1/2, byf[i][j] at y-face j+1/2
+#ifdef MHD_2P5D
+    Grid w,bz;
+#endif
+    long steps = 0; // number of solve_MHD steps applied
+    FlowField(int nx,int ny,double dx,double dy,double x0=0.0,double y0=0.0,
+              const std::string& backing_file="");
     FlowField(const Grid& g);
+
+private:
+    FlowField(int nx,int ny,double dx,double dy,double x0,double y0,std::shared_ptr<BackingFile> file);
 };
+
+#include "field_expr.hpp"
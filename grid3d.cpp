@@ -0,0 +1,132 @@
+#include "grid3d.hpp"
+#include "exec.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+Grid3D::Grid3D(int nx_, int ny_, int nz_, double dx_, double dy_, double dz_,
+               double x0_, double y0_, double z0_)
+    : nx(nx_), ny(ny_), nz(nz_), dx(dx_), dy(dy_), dz(dz_), x0(x0_), y0(y0_), z0(z0_),
+      sx(nx_ + 2*ng), sy(ny_ + 2*ng), sz(nz_ + 2*ng)
+{
+    if(nx_ < ng || ny_ < ng || nz_ < ng)
+        throw std::invalid_argument("Grid3D needs at least 2 interior cells per direction");
+}
+
+struct FlowField3D::MappedFile {
+    std::string path;
+    int fd = -1;
+    void* addr = MAP_FAILED;
+    size_t length = 0;
+
+    MappedFile(const std::string& p, size_t bytes) : path(p), length(bytes) {
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if(fd < 0 || ftruncate(fd, (off_t)length) != 0)
+            fail("cannot create");
+        addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(addr == MAP_FAILED) fail("cannot map");
+    }
+    ~MappedFile(){
+        if(addr != MAP_FAILED) munmap(addr, length);
+        if(fd >= 0){ close(fd); unlink(path.c_str()); }
+    }
+    [[noreturn]] void fail(const char* what){
+        std::string msg = std::string("FlowField3D: ") + what + " backing file '" + path + "': " + std::strerror(errno);
+        if(fd >= 0){ close(fd); unlink(path.c_str()); }
+        throw std::runtime_error(msg);
+    }
+};
+
+FlowField3D::FlowField3D(int nx, int ny, int nz, double dx, double dy, double dz,
+                         double x0, double y0, double z0, const std::string& backing_file)
+    : grid(nx, ny, nz, dx, dy, dz, x0, y0, z0)
+{
+    if(backing_file.empty()){
+        buf_.assign((size_t)NVAR3D * grid.size(), 0.0);
+        data_ = buf_.data();
+    } else {
+        file_ = std::make_unique<MappedFile>(backing_file, bytes());   // a fresh file reads as zeros
+        data_ = static_cast<double*>(file_->addr);
+    }
+}
+
+FlowField3D::~FlowField3D() = default;
+FlowField3D::FlowField3D(FlowField3D&&) noexcept = default;
+
+// Apply f(byte offset, length) to the page-aligned cover of x-planes [i0, i1) in every field
+template <class F>
+static void for_plane_ranges(const Grid3D& g, int i0, int i1, F&& f){
+    i0 = std::max(i0, -Grid3D::ng);
+    i1 = std::min(i1, g.nx + Grid3D::ng);
+    if(i0 >= i1) return;
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    for(int v = 0; v < NVAR3D; ++v){
+        size_t lo = ((size_t)v * g.size() + g.idx(i0, -Grid3D::ng, -Grid3D::ng)) * sizeof(double);
+        size_t hi = ((size_t)v * g.size() + g.idx(i1, -Grid3D::ng, -Grid3D::ng)) * sizeof(double);
+        lo = lo / page * page;
+        hi = (hi + page - 1) / page * page;
+        f(lo, hi - lo);
+    }
+}
+
+void FlowField3D::prefetch_planes(int i0, int i1) const {
+    if(!file_) return;
+    char* base = static_cast<char*>(file_->addr);
+    for_plane_ranges(grid, i0, i1, [&](size_t off, size_t len){
+        len = std::min(len, file_->length - off);
+        madvise(base + off, len, MADV_WILLNEED);   // asynchronous read-ahead
+    });
+}
+
+void FlowField3D::release_planes(int i0, int i1) const {
+    if(!file_) return;
+    char* base = static_cast<char*>(file_->addr);
+    for_plane_ranges(grid, i0, i1, [&](size_t off, size_t len){
+        len = std::min(len, file_->length - off);
+        // Queue the dirty pages for write-back without waiting, unmap them, and
+        // drop whatever is already clean from the page cache
+        sync_file_range(file_->fd, (off_t)off, (off_t)len, SYNC_FILE_RANGE_WRITE);
+        madvise(base + off, len, MADV_DONTNEED);
+        posix_fadvise(file_->fd, (off_t)off, (off_t)len, POSIX_FADV_DONTNEED);
+    });
+}
+
+void apply_periodic_bc_3d(FlowField3D& flow){
+    const Grid3D& g = flow.grid;
+    const int ng = Grid3D::ng;
+    for(int v = 0; v < NVAR3D; ++v){
+        double* a = flow.var(v);
+        // z first on interior rows, then y on whole rows, then x on whole planes,
+        // so edges and corners end up periodic as well
+        exec::for_2d(0, g.nx, 0, g.ny, [&](int i, int j){
+            for(int l = 1; l <= ng; ++l){
+                a[g.idx(i,j,-l)]       = a[g.idx(i,j,g.nz-l)];
+                a[g.idx(i,j,g.nz-1+l)] = a[g.idx(i,j,l-1)];
+            }
+        });
+        exec::for_each(0, g.nx, [&](long i){
+            for(int l = 1; l <= ng; ++l)
+                for(int k = -ng; k < g.nz+ng; ++k){
+                    a[g.idx(i,-l,k)]       = a[g.idx(i,g.ny-l,k)];
+                    a[g.idx(i,g.ny-1+l,k)] = a[g.idx(i,l-1,k)];
+                }
+        });
+        const size_t plane = g.plane();
+        for(int l = 1; l <= ng; ++l){
+            double* lo_dst = a + g.idx(-l,-ng,-ng);
+            double* hi_dst = a + g.idx(g.nx-1+l,-ng,-ng);
+            const double* lo_src = a + g.idx(g.nx-l,-ng,-ng);
+            const double* hi_src = a + g.idx(l-1,-ng,-ng);
+            exec::for_blocks(0, (long)plane, [&](long b, long e){
+                #pragma omp simd
+                for(long s = b; s < e; ++s){
+                    lo_dst[s] = lo_src[s];
+                    hi_dst[s] = hi_src[s];
+                }
+            });
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "hugepage.hpp"
+
+/**
+ * Uniform 3-D cell-centred mesh. nx, ny, nz count interior cells; every
+ * direction carries ng ghost layers, so valid indices run from -ng to n+ng-1.
+ * Storage is row-major with k contiguous.
+ */
+struct Grid3D {
+    static constexpr int ng = 2;   // MUSCL needs two cells on each side of a face
+    int nx, ny, nz;
+    double dx, dy, dz;
+    double x0, y0, z0;             // lower corner of the interior
+    int sx, sy, sz;                // padded extents (n + 2*ng)
+
+    Grid3D(int nx, int ny, int nz, double dx, double dy, double dz,
+           double x0 = 0.0, double y0 = 0.0, double z0 = 0.0);
+
+    size_t size() const { return (size_t)sx * sy * sz; }
+    size_t plane() const { return (size_t)sy * sz; }   // one i-plane, ghosts included
+    size_t idx(int i, int j, int k) const {
+        return ((size_t)(i + ng) * sy + (j + ng)) * sz + (k + ng);
+    }
+};
+
+// Conserved variables of the 3-D solver
+enum Var3D { RHO3, MX3, MY3, MZ3, EN3, BX3, BY3, BZ3, PSI3, NVAR3D };
+
+/**
+ * 3-D MHD state. Only the NVAR3D conserved fields are stored (structure of
+ * arrays, one contiguous block each); primitives are formed on the fly, so
+ * the state costs NVAR3D doubles per cell.
+ *
+ * With a backing file the fields live in that file, memory-mapped, instead
+ * of in RAM (out-of-core). The solver then pages the state through memory in
+ * slabs of slab_planes x-planes (see solve_MHD_3d). The file is created,
+ * sized, and removed again when the field is destroyed. Not copyable.
+ */
+struct FlowField3D {
+    Grid3D grid;
+    long steps = 0; // number of solve_MHD_3d steps applied
+    int slab_planes = 8;   // out-of-core paging unit, in x-planes
+
+    // CFL limit of the current state (before the cfl factor), left by
+    // solve_MHD_3d so the next step does not have to read the state again.
+    // Valid while step == steps; any non-const field access resets it.
+    struct CflCache { long step = -1; double dt_min = 0.0, gamma = 0.0; };
+    CflCache cfl_cache;
+
+    FlowField3D(int nx, int ny, int nz, double dx, double dy, double dz,
+                double x0 = 0.0, double y0 = 0.0, double z0 = 0.0,
+                const std::string& backing_file = "");
+    ~FlowField3D();
+    FlowField3D(FlowField3D&&) noexcept;
+    FlowField3D(const FlowField3D&) = delete;
+    FlowField3D& operator=(const FlowField3D&) = delete;
+
+    double*       var(int v)       { cfl_cache.step = -1; return data_ + (size_t)v * grid.size(); }
+    const double* var(int v) const { return data_ + (size_t)v * grid.size(); }
+    double&       operator()(int v, int i, int j, int k)       { return var(v)[grid.idx(i,j,k)]; }
+    double        operator()(int v, int i, int j, int k) const { return var(v)[grid.idx(i,j,k)]; }
+
+    // Bytes of field storage, ghosts included
+    size_t bytes() const { return (size_t)NVAR3D * grid.size() * sizeof(double); }
+
+    bool out_of_core() const { return file_ != nullptr; }
+    // Out-of-core paging of x-planes [i0, i1) (ghost planes included, clipped
+    // to the grid) of every field; no-ops in memory.
+    // prefetch: start reading them in the background
+    void prefetch_planes(int i0, int i1) const;
+    // release: start writing them back and drop them from memory
+    void release_planes(int i0, int i1) const;
+
+private:
+    struct MappedFile;
+    std::vector<double, HugePageAllocator<double>> buf_;   // in-memory storage, huge-page backed when large
+    std::unique_ptr<MappedFile> file_;                     // out-of-core storage
+    double* data_ = nullptr;
+};
+
+// Fill the ghost layers of every field periodically
+void apply_periodic_bc_3d(FlowField3D& flow);
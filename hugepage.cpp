@@ -0,0 +1,189 @@
+#include "hugepage.hpp"
+#include <sys/mman.h>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+namespace {
+
+enum class Kind { Hugetlb1G, Hugetlb2M, Thp, Small };
+
+struct Mapping {
+    Kind kind;
+    void* base;      // start of the mapping; the block itself starts a colour offset in
+    size_t length;   // mapped length, for munmap
+};
+
+std::atomic<HugePages> g_mode{HugePages::Auto};
+std::mutex g_mutex;
+std::map<void*, Mapping> g_mappings;   // every mmap'd block, so huge_free knows how to release it
+std::multimap<size_t, std::pair<void*, Kind>> g_cache;   // released mappings by length, kept for reuse
+size_t g_cached = 0;
+unsigned g_colour = 0;
+HugePageStats g_stats;
+
+// The solver allocates the same scratch arrays every step; unmapping them
+// would make each step fault in (and zero) fresh huge pages
+constexpr size_t kCacheMax = size_t(512) << 20;
+
+// Every mapping starts on a huge-page boundary, so without an offset all field
+// arrays would alias to the same cache sets and the stencils, which read many
+// of them at the same index, would evict each other. Blocks are staggered by
+// a rotating multiple of 17 cache lines.
+constexpr size_t kColourStep = 17 * 64;
+constexpr unsigned kColours = 16;
+
+constexpr size_t k2M = size_t(2) << 20;
+constexpr size_t k1G = size_t(1) << 30;
+
+size_t round_up(size_t n, size_t to) { return (n + to - 1) / to * to; }
+
+size_t& counter(Kind k) {
+    switch (k) {
+        case Kind::Hugetlb1G: return g_stats.hugetlb_1g;
+        case Kind::Hugetlb2M: return g_stats.hugetlb_2m;
+        case Kind::Thp:       return g_stats.thp;
+        default:              return g_stats.small;
+    }
+}
+
+void* map_hugetlb(size_t bytes, size_t page, int flag, size_t& length) {
+    length = round_up(bytes, page);
+    void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | flag, -1, 0);
+    return p == MAP_FAILED ? nullptr : p;
+}
+
+// 2 MB aligned anonymous mapping: over-map by one huge page and trim
+void* map_aligned(size_t bytes, size_t& length) {
+    length = round_up(bytes, k2M);
+    size_t raw_len = length + k2M;
+    void* raw = mmap(nullptr, raw_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+    char* base = static_cast<char*>(raw);
+    char* p = reinterpret_cast<char*>(round_up(reinterpret_cast<size_t>(base), k2M));
+    if (p > base) munmap(base, p - base);
+    char* end = p + length;
+    if (base + raw_len > end) munmap(end, base + raw_len - end);
+    return p;
+}
+
+std::string read_first_line(const char* path) {
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+
+// AnonHugePages of this process in kB, or -1 if unavailable
+long anon_huge_kb() {
+    std::ifstream in("/proc/self/smaps_rollup");
+    std::string key;
+    long kb;
+    while (in >> key) {
+        if (key == "AnonHugePages:" && in >> kb) return kb;
+        in.ignore(1 << 20, '\n');
+    }
+    return -1;
+}
+
+} // namespace
+
+void set_huge_pages(HugePages mode) { g_mode = mode; }
+HugePages get_huge_pages() { return g_mode; }
+
+void* huge_alloc(size_t bytes) {
+    const HugePages mode = g_mode;
+    if (bytes < kHugePageMin || mode == HugePages::Off)
+        return ::operator new(bytes);
+
+    const size_t padded = bytes + kColourStep * (kColours - 1);
+    void* base = nullptr;
+    size_t length = 0;
+    Kind kind = Kind::Small;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        const size_t want = round_up(padded, k2M);
+        for (auto it = g_cache.lower_bound(want); it != g_cache.end() && it->first == want; ++it) {
+            if (mode == HugePages::Transparent && it->second.second != Kind::Thp && it->second.second != Kind::Small)
+                continue;
+            base = it->second.first;
+            kind = it->second.second;
+            length = want;
+            g_cached -= want;
+            g_cache.erase(it);
+            break;
+        }
+    }
+    if (!base && mode == HugePages::Auto) {
+        if (padded >= k1G && (base = map_hugetlb(padded, k1G, MAP_HUGE_1GB, length)))
+            kind = Kind::Hugetlb1G;
+        else if ((base = map_hugetlb(padded, k2M, MAP_HUGE_2MB, length)))
+            kind = Kind::Hugetlb2M;
+    }
+    if (!base && (base = map_aligned(padded, length)))
+        kind = madvise(base, length, MADV_HUGEPAGE) == 0 ? Kind::Thp : Kind::Small;
+    if (!base) throw std::bad_alloc();
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    void* p = static_cast<char*>(base) + kColourStep * (g_colour++ % kColours);
+    g_mappings[p] = {kind, base, length};
+    counter(kind) += length;
+    return p;
+}
+
+void huge_free(void* p, size_t bytes) noexcept {
+    if (!p) return;
+    if (bytes >= kHugePageMin) {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        auto it = g_mappings.find(p);
+        if (it != g_mappings.end()) {
+            Mapping m = it->second;
+            g_mappings.erase(it);
+            counter(m.kind) -= m.length;
+            if (g_cached + m.length <= kCacheMax) {
+                g_cache.emplace(m.length, std::make_pair(m.base, m.kind));
+                g_cached += m.length;
+                return;
+            }
+            lock.unlock();
+            munmap(m.base, m.length);
+            return;
+        }
+    }
+    ::operator delete(p);   // small block, or allocated while the mode was Off
+}
+
+HugePageStats huge_page_stats() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    HugePageStats s = g_stats;
+    s.cached = g_cached;
+    return s;
+}
+
+std::string huge_page_report() {
+    const HugePageStats s = huge_page_stats();
+    const HugePages mode = g_mode;
+    auto mb = [](size_t b) { return b >> 20; };
+    std::ostringstream out;
+    out << "huge pages " << (mode == HugePages::Auto ? "auto" : mode == HugePages::Transparent ? "thp" : "off")
+        << ": " << mb(s.hugetlb_1g) << " MB on 1G pages, " << mb(s.hugetlb_2m) << " MB on 2M pages, "
+        << mb(s.thp) << " MB THP-advised, " << mb(s.small) << " MB on 4K pages, " << mb(s.cached) << " MB cached for reuse";
+    std::string thp = read_first_line("/sys/kernel/mm/transparent_hugepage/enabled");
+    if (!thp.empty()) out << " (THP " << thp << ")";
+    long kb = anon_huge_kb();
+    if (kb >= 0) out << ", " << (kb >> 10) << " MB anonymous memory on huge pages";
+    return out.str();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <string>
+
+// Huge-page backing for large field and scratch buffers. Blocks of at least
+// kHugePageMin bytes are mapped with mmap:
+//  - Auto:        explicit huge pages (MAP_HUGETLB, 1 GB pages for blocks of
+//                 1 GB or more, else 2 MB), falling back to transparent huge
+//                 pages and finally to normal pages;
+//  - Transparent: 2 MB aligned anonymous mapping with madvise(MADV_HUGEPAGE);
+//  - Off:         plain operator new.
+// Smaller blocks always use operator new. Released mappings are cached (up
+// to 512 MB) and handed out again for the next request of the same size.
+enum class HugePages { Off, Transparent, Auto };
+
+constexpr size_t kHugePageMin = size_t(2) << 20;
+
+void set_huge_pages(HugePages mode);
+HugePages get_huge_pages();
+
+void* huge_alloc(size_t bytes);
+void huge_free(void* p, size_t bytes) noexcept;
+
+// Bytes currently held in each kind of mapping
+struct HugePageStats {
+    size_t hugetlb_1g = 0;   // MAP_HUGETLB, 1 GB pages
+    size_t hugetlb_2m = 0;   // MAP_HUGETLB, 2 MB pages
+    size_t thp = 0;          // madvise(MADV_HUGEPAGE); the kernel decides the backing
+    size_t small = 0;        // >= kHugePageMin but on normal pages
+    size_t cached = 0;       // released blocks kept mapped for the next allocation of that size
+};
+HugePageStats huge_page_stats();
+
+// One line for the run log: the mode, the bytes per page kind, the kernel's
+// THP setting and how much anonymous memory is actually on huge pages
+std::string huge_page_report();
+
+// std::allocator replacement routing through huge_alloc (stateless)
+template <class T>
+struct HugePageAllocator {
+    using value_type = T;
+    HugePageAllocator() = default;
+    template <class U> HugePageAllocator(const HugePageAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n > size_t(-1) / sizeof(T)) throw std::bad_array_new_length();
+        return static_cast<T*>(huge_alloc(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t n) noexcept { huge_free(p, n * sizeof(T)); }
+
+    template <class U> bool operator==(const HugePageAllocator<U>&) const noexcept { return true; }
+    template <class U> bool operator!=(const HugePageAllocator<U>&) const noexcept { return false; }
+};
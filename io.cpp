@@ -1,6 +1,10 @@
 #include "io.hpp"
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <filesystem>
+#include <sstream>
+#include <stdexcept>
 
 static void dump_scalar(const Grid& g,const std::string& fname){
     std::ofstream out(fname);
@@ -22,4 +26,228 @@ void save_flow_MHD(const FlowField& flow,const std::string& dir,int step){
     dump_scalar(flow.bx,  prefix+"bx_"+std::to_string(step)+".csv");
     dump_scalar(flow.by,  prefix+"by_"+std::to_string(step)+".csv");
     dump_scalar(flow.psi, prefix+"psi_"+std::to_string(step)+".csv");
+#ifdef MHD_2P5D
+    dump_scalar(flow.w,   prefix+"w_"+std::to_string(step)+".csv");
+    dump_scalar(flow.bz,  prefix+"bz_"+std::to_string(step)+".csv");
+#endif
+}
+
+// Mid-plane fields of the 3-D output, nx*ny values each, value(i,j) at i*ny + j
+static std::vector<std::pair<std::string, std::vector<double>>> midplane_3d(const FlowField3D& flow){
+    const Grid3D& g = flow.grid;
+    const int k = g.nz/2;
+    std::vector<std::pair<std::string, std::vector<double>>> out;
+    auto add = [&](const std::string& name, auto value){
+        std::vector<double> a((size_t)g.nx*g.ny);
+        for(int i=0;i<g.nx;++i)
+            for(int j=0;j<g.ny;++j)
+                a[(size_t)i*g.ny+j] = value(i,j);
+        out.emplace_back(name, std::move(a));
+    };
+    auto field = [&](int v){ return [&flow,v,k](int i,int j){ return flow(v,i,j,k); }; };
+    auto velocity = [&](int m){ return [&flow,m,k](int i,int j){ return flow(m,i,j,k)/flow(RHO3,i,j,k); }; };
+    add("rho", field(RHO3));
+    add("u",   velocity(MX3));
+    add("v",   velocity(MY3));
+    add("w",   velocity(MZ3));
+    add("e",   field(EN3));
+    add("bx",  field(BX3));
+    add("by",  field(BY3));
+    add("bz",  field(BZ3));
+    add("psi", field(PSI3));
+    return out;
+}
+
+void save_flow_MHD_3d(const FlowField3D& flow,const std::string& dir,int step){
+    std::filesystem::create_directory(dir);
+    const Grid3D& g = flow.grid;
+    for(const auto& [name, a] : midplane_3d(flow)){
+        std::ofstream out(dir + "/out_" + name + "_" + std::to_string(step) + ".csv");
+        for(int i=0;i<g.nx;++i)
+            for(int j=0;j<g.ny;++j){
+                double x=g.x0+(i+0.5)*g.dx;
+                double y=g.y0+(j+0.5)*g.dy;
+                out<<x<<','<<y<<','<<a[(size_t)i*g.ny+j]<<'\n';
+            }
+    }
+}
+
+// ---- Output streams --------------------------------------------------------
+
+namespace {
+
+using FieldPtr = Grid FlowField::*;
+
+const std::vector<std::pair<std::string, FieldPtr>>& output_fields(){
+    static const std::vector<std::pair<std::string, FieldPtr>> table = {
+        {"rho", &FlowField::rho}, {"u", &FlowField::u}, {"v", &FlowField::v}, {"p", &FlowField::p},
+        {"e", &FlowField::e}, {"bx", &FlowField::bx}, {"by", &FlowField::by}, {"psi", &FlowField::psi},
+#ifdef MHD_2P5D
+        {"w", &FlowField::w}, {"bz", &FlowField::bz},
+#endif
+    };
+    return table;
+}
+
+// The fields save_flow_MHD writes, in its order
+std::vector<std::string> default_fields(){
+    std::vector<std::string> names = {"rho", "u", "v", "e", "bx", "by", "psi"};
+#ifdef MHD_2P5D
+    names.push_back("w");
+    names.push_back("bz");
+#endif
+    return names;
+}
+
+std::invalid_argument spec_error(const std::string& text, const std::string& why){
+    return std::invalid_argument("output: " + why + " in '" + text + "'");
+}
+
+int positive_int(const std::string& text, const std::string& v){
+    size_t pos = 0;
+    int x = 0;
+    try { x = std::stoi(v, &pos); } catch(const std::exception&) { pos = 0; }
+    if(pos == 0 || pos != v.size() || x < 1) throw spec_error(text, "expected a positive integer, got '" + v + "'");
+    return x;
+}
+
+double number(const std::string& text, const std::string& v){
+    size_t pos = 0;
+    double x = 0.0;
+    try { x = std::stod(v, &pos); } catch(const std::exception&) { pos = 0; }
+    if(pos == 0 || pos != v.size()) throw spec_error(text, "expected a number, got '" + v + "'");
+    return x;
+}
+
+std::vector<std::string> split(const std::string& s, char sep){
+    std::vector<std::string> parts;
+    size_t b = 0;
+    for(size_t e; (e = s.find(sep, b)) != std::string::npos; b = e + 1) parts.push_back(s.substr(b, e - b));
+    parts.push_back(s.substr(b));
+    return parts;
+}
+
+// Index range [lo, hi] of the cells with coordinate in [a, b]
+std::pair<int, int> index_range(double a, double b, double origin, double h, int n){
+    double lo = std::max(0.0, std::ceil((a - origin)/h - 1e-9));
+    double hi = std::min(n - 1.0, std::floor((b - origin)/h + 1e-9));
+    return {(int)std::min(lo, (double)n), (int)std::max(hi, -1.0)};
+}
+
+} // namespace
+
+OutputSpec parse_output_spec(const std::string& text){
+    std::istringstream in(text);
+    OutputSpec spec;
+    if(!(in >> spec.name) || spec.name.find_first_of("=/") != std::string::npos)
+        throw spec_error(text, "expected a stream name first");
+    bool stride = false;
+    for(std::string tok; in >> tok; ){
+        size_t eq = tok.find('=');
+        if(eq == std::string::npos) throw spec_error(text, "expected key=value, got '" + tok + "'");
+        const std::string key = tok.substr(0, eq), v = tok.substr(eq + 1);
+        if(key == "every") spec.every = positive_int(text, v);
+        else if(key == "stride" || key == "average"){
+            if(spec.factor > 1 || stride || spec.average) throw spec_error(text, "stride and average are exclusive");
+            spec.factor = positive_int(text, v);
+            stride = key == "stride";
+            spec.average = key == "average";
+        }
+        else if(key == "region"){
+            std::vector<std::string> axes = split(v, ',');
+            if(axes.size() != 2) throw spec_error(text, "region expects x0:x1,y0:y1");
+            std::vector<std::string> x = split(axes[0], ':'), y = split(axes[1], ':');
+            if(x.size() != 2 || y.size() != 2) throw spec_error(text, "region expects x0:x1,y0:y1");
+            spec.x0 = number(text, x[0]); spec.x1 = number(text, x[1]);
+            spec.y0 = number(text, y[0]); spec.y1 = number(text, y[1]);
+            if(spec.x0 > spec.x1 || spec.y0 > spec.y1) throw spec_error(text, "empty region");
+        }
+        else if(key == "fields"){
+            spec.fields = split(v, ',');
+            for(const std::string& f : spec.fields){
+                auto& t = output_fields();
+                if(std::none_of(t.begin(), t.end(), [&](const auto& e){ return e.first == f; }))
+                    throw spec_error(text, "unknown field '" + f + "'");
+            }
+        }
+        else throw spec_error(text, "unknown key '" + key + "'");
+    }
+    return spec;
+}
+
+std::string format_output_spec(const OutputSpec& spec){
+    std::ostringstream out;
+    out << spec.name << " every=" << spec.every;
+    if(spec.x0 > -1e300 || spec.x1 < 1e300 || spec.y0 > -1e300 || spec.y1 < 1e300)
+        out << " region=" << spec.x0 << ":" << spec.x1 << "," << spec.y0 << ":" << spec.y1;
+    if(spec.factor > 1) out << (spec.average ? " average=" : " stride=") << spec.factor;
+    if(!spec.fields.empty()){
+        out << " fields=";
+        for(size_t k = 0; k < spec.fields.size(); ++k) out << (k ? "," : "") << spec.fields[k];
+    }
+    return out.str();
+}
+
+void save_flow_MHD(const FlowField& flow, const OutputSpec& spec, const std::string& dir, int step){
+    const Grid& g = flow.rho;
+    auto [i0, i1] = index_range(spec.x0, spec.x1, g.x0, g.dx, g.nx);
+    auto [j0, j1] = index_range(spec.y0, spec.y1, g.y0, g.dy, g.ny);
+    if(i0 > i1 || j0 > j1)
+        throw std::invalid_argument("output: region of stream '" + spec.name + "' contains no cells");
+
+    const std::string sub = dir + "/" + spec.name;
+    std::filesystem::create_directories(sub);
+    const int f = spec.factor;
+    for(const std::string& name : spec.fields.empty() ? default_fields() : spec.fields){
+        const auto& t = output_fields();
+        const Grid& field = flow.*(std::find_if(t.begin(), t.end(), [&](const auto& e){ return e.first == name; })->second);
+        std::ofstream out(sub + "/out_" + name + "_" + std::to_string(step) + ".csv");
+        for(int i = i0; i <= i1; i += f)
+            for(int j = j0; j <= j1; j += f){
+                if(!spec.average){
+                    out << g.x0 + i*g.dx << ',' << g.y0 + j*g.dy << ',' << field.data[i][j] << '\n';
+                    continue;
+                }
+                // Block mean, clipped to the region at its upper edges
+                const int ie = std::min(i + f, i1 + 1), je = std::min(j + f, j1 + 1);
+                double sum = 0.0;
+                for(int a = i; a < ie; ++a)
+                    for(int b = j; b < je; ++b) sum += field.data[a][b];
+                out << g.x0 + 0.5*(i + ie - 1)*g.dx << ',' << g.y0 + 0.5*(j + je - 1)*g.dy << ','
+                    << sum / ((ie - i)*(je - j)) << '\n';
+            }
+    }
+}
+
+// ---- Snapshot container ----------------------------------------------------
+
+SnapshotLayout snapshot_layout(const FlowField& flow){
+    const Grid& g = flow.rho;
+    SnapshotLayout l;
+    l.nx = g.nx; l.ny = g.ny;
+    l.x0 = g.x0; l.y0 = g.y0; l.dx = g.dx; l.dy = g.dy;
+    for(const auto& f : output_fields()) l.fields.push_back(f.first);
+    return l;
+}
+
+void save_flow_snapshot(SnapshotWriter& out, const FlowField& flow, int step, double time){
+    std::vector<const double*> data;
+    for(const auto& f : output_fields()) data.push_back((flow.*f.second).data.ptr());
+    out.append(step, time, data);
+}
+
+SnapshotLayout snapshot_layout_3d(const FlowField3D& flow){
+    const Grid3D& g = flow.grid;
+    SnapshotLayout l;
+    l.nx = g.nx; l.ny = g.ny;
+    l.x0 = g.x0 + 0.5*g.dx; l.y0 = g.y0 + 0.5*g.dy; l.dx = g.dx; l.dy = g.dy;
+    l.fields = {"rho", "u", "v", "w", "e", "bx", "by", "bz", "psi"};
+    return l;
+}
+
+void save_flow_snapshot_3d(SnapshotWriter& out, const FlowField3D& flow, int step, double time){
+    const auto fields = midplane_3d(flow);
+    std::vector<const double*> data;
+    for(const auto& f : fields) data.push_back(f.second.data());
+    out.append(step, time, data);
 }
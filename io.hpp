@@ -1,5 +1,41 @@
 #pragma once
 #include <string>
+#include <vector>
 #include "grid.hpp"
+#include "grid3d.hpp"
+#include "snapshot.hpp"
+
+// Where the full dumps go: CSV files per field and step, the snapshot
+// container (snapshot.hpp), or both
+enum class OutputFormat { CSV, Snapshots, Both };
 
 void save_flow_MHD(const FlowField& flow, const std::string& dir, int step);
+
+// An extra 2-D output stream. It writes the chosen fields of a rectangular
+// region, optionally downsampled, every `every` steps to
+// <dir>/<name>/out_<field>_<step>.csv, in the same x,y,value format.
+struct OutputSpec {
+    std::string name;
+    int every = 1;
+    double x0 = -1e300, x1 = 1e300;    // region in physical coordinates, bounds inclusive
+    double y0 = -1e300, y1 = 1e300;    //   (default: the whole grid, ghosts included)
+    int factor = 1;                    // keep every factor-th cell, or average factor x factor blocks
+    bool average = false;
+    std::vector<std::string> fields;   // empty: the fields save_flow_MHD writes
+};
+
+// Parse "<name> key=value ...": every=N, region=x0:x1,y0:y1, stride=N,
+// average=N and fields=rho,u,... (rho u v p e bx by psi, plus w bz in the
+// 2.5-D build). Throws std::invalid_argument on malformed specs.
+OutputSpec parse_output_spec(const std::string& text);
+std::string format_output_spec(const OutputSpec& spec);
+void save_flow_MHD(const FlowField& flow, const OutputSpec& spec, const std::string& dir, int step);
+// Primitive fields on the z mid-plane, in the same CSV format as the 2-D output
+void save_flow_MHD_3d(const FlowField3D& flow, const std::string& dir, int step);
+
+// Snapshot container records: in 2-D every output field (rho u v p e bx by
+// psi, plus w bz) over the whole grid, in 3-D the fields of save_flow_MHD_3d
+SnapshotLayout snapshot_layout(const FlowField& flow);
+void save_flow_snapshot(SnapshotWriter& out, const FlowField& flow, int step, double time);
+SnapshotLayout snapshot_layout_3d(const FlowField3D& flow);
+void save_flow_snapshot_3d(SnapshotWriter& out, const FlowField3D& flow, int step, double time);
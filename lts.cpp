@@ -0,0 +1,293 @@
+#include "lts.hpp"
+#include "riemann.hpp"
+#include "exec.hpp"
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+// Per-block CFL limit, same estimate as compute_cfl_timestep
+template <class Phys>
+std::vector<double> block_timesteps(const FlowField& flow, int block, int nbx, int nby, double cfl_number){
+    const Grid& grid = flow.rho;
+    const double dt_glm = std::min(grid.dx, grid.dy) / Phys::ch;
+    std::vector<double> dt((size_t)nbx*nby);
+
+    exec::for_2d(0, nbx, 0, nby, [&](int bi, int bj){
+        double dt_min = 1e10;
+        const int i1 = std::min(1 + (bi+1)*block, grid.nx-1);
+        const int j1 = std::min(1 + (bj+1)*block, grid.ny-1);
+        for(int i = 1 + bi*block; i < i1; ++i)
+            for(int j = 1 + bj*block; j < j1; ++j){
+                double Bz = 0.0;
+#ifdef MHD_2P5D
+                Bz = flow.bz.data[i][j];
+#endif
+                double cf = compute_fast_speed<Phys>(flow.rho.data[i][j], flow.p.data[i][j],
+                                               flow.bx.data[i][j], flow.by.data[i][j], Bz);
+                double dt_x = grid.dx / (std::abs(flow.u.data[i][j]) + cf);
+                double dt_y = grid.dy / (std::abs(flow.v.data[i][j]) + cf);
+                dt_min = std::min(dt_min, std::min(dt_x, dt_y));
+            }
+        if(dt_min > 1.0) // prevent unrealistically large dt due to NaNs
+            dt_min = dt_glm;
+        dt[(size_t)bi*nby + bj] = cfl_number * std::min(dt_min, dt_glm);
+    });
+    return dt;
+}
+
+// Interior-periodic neighbours; also the index policy for the stencils
+struct Periodic : stencil::InteriorWrap {
+    int ip(int k) const { return i(k, 1); }
+    int im(int k) const { return i(k, -1); }
+    int jp(int k) const { return j(k, 1); }
+    int jm(int k) const { return j(k, -1); }
+};
+
+inline double slope(const Grid& g, int im, int jm, int i, int j, int ip, int jp){
+    return minmod(g.data[i][j] - g.data[im][jm], g.data[ip][jp] - g.data[i][j]);
+}
+
+// MUSCL-HLL flux at the x-face between interior cells i and ip(i)
+template <class Phys>
+HLLFlux face_flux_x(const FlowField& f, const Periodic& P, int i, int j){
+    const int a = P.im(i), b = i, c = P.ip(i), d = P.ip(c);
+    auto L = [&](const Grid& g){ return g.data[b][j] + 0.5*slope(g, a, j, b, j, c, j); };
+    auto R = [&](const Grid& g){ return g.data[c][j] - 0.5*slope(g, b, j, c, j, d, j); };
+    return compute_hll_flux_x<Phys>(L(f.rho), L(f.u), L(f.v), L(f.p), L(f.bx), L(f.by), L(f.psi),
+                              R(f.rho), R(f.u), R(f.v), R(f.p), R(f.bx), R(f.by), R(f.psi)
+#ifdef MHD_2P5D
+                              , L(f.w), L(f.bz), R(f.w), R(f.bz)
+#endif
+                              );
+}
+
+// MUSCL-HLL flux at the y-face between interior cells j and jp(j)
+template <class Phys>
+HLLFlux face_flux_y(const FlowField& f, const Periodic& P, int i, int j){
+    const int a = P.jm(j), b = j, c = P.jp(j), d = P.jp(c);
+    auto L = [&](const Grid& g){ return g.data[i][b] + 0.5*slope(g, i, a, i, b, i, c); };
+    auto R = [&](const Grid& g){ return g.data[i][c] - 0.5*slope(g, i, b, i, c, i, d); };
+    return compute_hll_flux_y<Phys>(L(f.rho), L(f.u), L(f.v), L(f.p), L(f.bx), L(f.by), L(f.psi),
+                              R(f.rho), R(f.u), R(f.v), R(f.p), R(f.bx), R(f.by), R(f.psi)
+#ifdef MHD_2P5D
+                              , L(f.w), L(f.bz), R(f.w), R(f.bz)
+#endif
+                              );
+}
+
+void fill_ghosts(FlowField& flow){
+    std::vector<Grid*> fields = {&flow.rho, &flow.u, &flow.v, &flow.p, &flow.e, &flow.bx, &flow.by, &flow.psi};
+#ifdef MHD_2P5D
+    fields.push_back(&flow.w);
+    fields.push_back(&flow.bz);
+#endif
+    for(Grid* g : fields){
+        exec::for_each(0, g->ny, [&](long j){
+            g->data[0][j]       = g->data[g->nx-2][j];
+            g->data[g->nx-1][j] = g->data[1][j];
+        });
+        exec::for_each(0, g->nx, [&](long i){
+            g->data[i][0]       = g->data[i][g->ny-2];
+            g->data[i][g->ny-1] = g->data[i][1];
+        });
+    }
+}
+
+enum { A_RHO, A_MX, A_MY, A_E, A_BX, A_BY, A_PSI,
+#ifdef MHD_2P5D
+       A_MZ, A_BZ,
+#endif
+       NACC };
+
+} // namespace
+
+double compute_lts_timestep(const FlowField& flow, int levels, int block, double cfl_number){
+    block = std::max(1, block);
+    const int nbx = (flow.rho.nx-2 + block-1)/block, nby = (flow.rho.ny-2 + block-1)/block;
+    auto bdt = dispatch_physics([&](auto phys){
+        return block_timesteps<decltype(phys)>(flow, block, nbx, nby, cfl_number);
+    });
+    double dt_min = *std::min_element(bdt.begin(), bdt.end());
+    double dt_max = *std::max_element(bdt.begin(), bdt.end());
+    return std::min(dt_max, dt_min * (1 << (std::max(1, levels)-1)));
+}
+
+template <class Phys>
+static double lts_update_impl(FlowField& flow, double dt, double nu, const SolverOptions& opts){
+    Grid& grid = flow.rho;
+    const int nx = grid.nx, ny = grid.ny;
+    const int B = std::max(1, opts.lts_block);
+    const int nbx = (nx-2 + B-1)/B, nby = (ny-2 + B-1)/B;
+    const int L = std::max(1, opts.lts_levels);
+    const Periodic P{nx, ny};
+    const bool use_glm = (opts.divb == DivBScheme::GLM);
+    const bool explicit_diffusion = (opts.diffusion == DiffusionScheme::Explicit);
+
+    auto bdt = block_timesteps<Phys>(flow, B, nbx, nby, opts.cfl);
+    const double dt_min = *std::min_element(bdt.begin(), bdt.end());
+    const double dt_max = *std::max_element(bdt.begin(), bdt.end());
+    dt = std::min(dt, std::min(dt_max, dt_min * (1 << (L-1))));
+
+    // Block levels: smallest l with dt/2^l inside the block's CFL limit
+    std::vector<int> lvl((size_t)nbx*nby);
+    for(size_t b=0; b<lvl.size(); ++b){
+        int l = 0;
+        while(l < L-1 && dt/(1 << l) > bdt[b]) ++l;
+        lvl[b] = l;
+    }
+    // Neighbouring blocks differ by at most one level (periodic)
+    for(bool changed = true; changed; ){
+        changed = false;
+        for(int bi=0; bi<nbx; ++bi)
+            for(int bj=0; bj<nby; ++bj){
+                int& l = lvl[(size_t)bi*nby + bj];
+                for(auto [di, dj] : {std::pair{1,0}, {-1,0}, {0,1}, {0,-1}}){
+                    int ni = (bi + di + nbx) % nbx, nj = (bj + dj + nby) % nby;
+                    if(lvl[(size_t)ni*nby + nj] - 1 > l){ l = lvl[(size_t)ni*nby + nj] - 1; changed = true; }
+                }
+            }
+    }
+    const int top = *std::max_element(lvl.begin(), lvl.end());
+    const int S = 1 << top;   // finest substeps per dt
+    auto level = [&](int i, int j){ return lvl[(size_t)((i-1)/B)*nby + (j-1)/B]; };
+    auto active = [&](int l, int k){ return k % (S >> l) == 0; };
+
+    std::vector<Grid> acc(NACC, Grid(nx, ny, grid.dx, grid.dy, grid.x0, grid.y0));
+    std::vector<std::vector<HLLFlux>> fx(nx, std::vector<HLLFlux>(ny));
+    std::vector<std::vector<HLLFlux>> fy(nx, std::vector<HLLFlux>(ny));
+
+    for(int k=0; k<S; ++k){
+        // Faces advance at the rate of the finer adjacent cell
+        exec::for_2d(1, nx-1, 1, ny-1, [&](int i, int j){
+            if(active(std::max(level(i,j), level(P.ip(i),j)), k)) fx[i][j] = face_flux_x<Phys>(flow, P, i, j);
+            if(active(std::max(level(i,j), level(i,P.jp(j))), k)) fy[i][j] = face_flux_y<Phys>(flow, P, i, j);
+        });
+
+        // Gather active face contributions into the cell accumulators
+        exec::for_2d(1, nx-1, 1, ny-1, [&](int i, int j){
+            const int lc = level(i,j);
+            auto add = [&](const HLLFlux& F, double w){
+                acc[A_RHO].data[i][j] += w*F.F_rho;
+                acc[A_MX].data[i][j]  += w*F.F_momx;
+                acc[A_MY].data[i][j]  += w*F.F_momy;
+                acc[A_E].data[i][j]   += w*F.F_E;
+                acc[A_BX].data[i][j]  += w*F.F_Bx;
+                acc[A_BY].data[i][j]  += w*F.F_By;
+                acc[A_PSI].data[i][j] += w*F.F_psi;
+#ifdef MHD_2P5D
+                acc[A_MZ].data[i][j]  += w*F.F_momz;
+                acc[A_BZ].data[i][j]  += w*F.F_Bz;
+#endif
+            };
+            int lf;
+            if(active(lf = std::max(lc, level(P.ip(i),j)), k)) add(fx[i][j],       -dt/(1 << lf)/grid.dx);
+            if(active(lf = std::max(lc, level(P.im(i),j)), k)) add(fx[P.im(i)][j],  dt/(1 << lf)/grid.dx);
+            if(active(lf = std::max(lc, level(i,P.jp(j))), k)) add(fy[i][j],       -dt/(1 << lf)/grid.dy);
+            if(active(lf = std::max(lc, level(i,P.jm(j))), k)) add(fy[i][P.jm(j)],  dt/(1 << lf)/grid.dy);
+        });
+
+        // Commit cells whose block completes its step: new conserved state into acc ...
+        auto commits = [&](int i, int j){ return (k+1) % (S >> level(i,j)) == 0; };
+        exec::for_2d(1, nx-1, 1, ny-1, [&](int i, int j){
+            if(!commits(i,j)) return;
+            const double dtc = dt/(1 << level(i,j));
+            double rho = flow.rho.data[i][j], u = flow.u.data[i][j], v = flow.v.data[i][j];
+            double Bx = flow.bx.data[i][j], By = flow.by.data[i][j], psi = flow.psi.data[i][j];
+
+            double rho_n = rho + acc[A_RHO].data[i][j];
+            double mx = rho*u + acc[A_MX].data[i][j];
+            double my = rho*v + acc[A_MY].data[i][j];
+            double e_n = flow.e.data[i][j] + acc[A_E].data[i][j];
+            double bx_n = Bx + acc[A_BX].data[i][j];
+            double by_n = By + acc[A_BY].data[i][j];
+            double psi_n = use_glm ? psi + acc[A_PSI].data[i][j] : psi;
+
+            if(explicit_diffusion && nu > 0){
+                mx += dtc * nu * rho * laplacian(flow.u, i, j, P);
+                my += dtc * nu * rho * laplacian(flow.v, i, j, P);
+            }
+            if(explicit_diffusion && Phys::eta > 0){
+                bx_n += dtc * Phys::eta * laplacian(flow.bx, i, j, P);
+                by_n += dtc * Phys::eta * laplacian(flow.by, i, j, P);
+            }
+#ifdef MHD_2P5D
+            double mz = rho*flow.w.data[i][j] + acc[A_MZ].data[i][j];
+            double bz_n = flow.bz.data[i][j] + acc[A_BZ].data[i][j];
+            if(explicit_diffusion && nu > 0)
+                mz += dtc * nu * rho * laplacian(flow.w, i, j, P);
+            if(explicit_diffusion && Phys::eta > 0)
+                bz_n += dtc * Phys::eta * laplacian(flow.bz, i, j, P);
+            acc[A_MZ].data[i][j] = mz;
+            acc[A_BZ].data[i][j] = bz_n;
+#endif
+            if(use_glm){
+                double divB = (flow.bx.data[P.ip(i)][j] - flow.bx.data[P.im(i)][j])/(2*grid.dx)
+                            + (flow.by.data[i][P.jp(j)] - flow.by.data[i][P.jm(j)])/(2*grid.dy);
+                psi_n = psi_n - dtc*Phys::ch*Phys::ch*divB - dtc*Phys::cr*psi_n;
+            }
+
+            acc[A_RHO].data[i][j] = std::max(rho_n, 1e-10);
+            acc[A_MX].data[i][j]  = mx;
+            acc[A_MY].data[i][j]  = my;
+            acc[A_E].data[i][j]   = std::max(e_n, 1e-10);
+            acc[A_BX].data[i][j]  = bx_n;
+            acc[A_BY].data[i][j]  = by_n;
+            acc[A_PSI].data[i][j] = psi_n;
+        });
+
+        // ... then into the primitive fields, resetting the accumulators
+        using Counts = std::pair<long, long>;   // nonfinite, negative
+        auto add_counts = [](Counts a, Counts b){ return Counts{a.first + b.first, a.second + b.second}; };
+        const auto [nonfinite, negative] = exec::reduce_2d(1, nx-1, 1, ny-1, Counts{0, 0}, add_counts, [&](int i, int j){
+            if(!commits(i,j)) return Counts{0, 0};
+            double rho = acc[A_RHO].data[i][j];
+            double u = acc[A_MX].data[i][j] / rho, v = acc[A_MY].data[i][j] / rho;
+            double Bx = acc[A_BX].data[i][j], By = acc[A_BY].data[i][j];
+            double e = acc[A_E].data[i][j];
+            flow.rho.data[i][j] = rho;
+            flow.u.data[i][j] = u;
+            flow.v.data[i][j] = v;
+            flow.bx.data[i][j] = Bx;
+            flow.by.data[i][j] = By;
+            flow.e.data[i][j] = e;
+            flow.psi.data[i][j] = acc[A_PSI].data[i][j];
+            double ie = e - 0.5*rho*(u*u + v*v) - 0.5*(Bx*Bx + By*By);
+#ifdef MHD_2P5D
+            double w = acc[A_MZ].data[i][j] / rho, Bz = acc[A_BZ].data[i][j];
+            flow.w.data[i][j] = w;
+            flow.bz.data[i][j] = Bz;
+            ie -= 0.5*rho*w*w + 0.5*Bz*Bz;
+#endif
+            flow.p.data[i][j] = (Phys::gamma - 1.0) * std::max(ie, 1e-10);
+            for(Grid& a : acc) a.data[i][j] = 0.0;
+            if(!std::isfinite(ie + u + v + flow.psi.data[i][j])) return Counts{1, 0};
+            return Counts{0, ie < 0};
+        });
+        if(opts.health){
+            opts.health->nonfinite += nonfinite;
+            opts.health->negative_pressure += negative;
+        }
+    }
+    fill_ghosts(flow);
+
+    if(opts.stats){
+        long performed = 0;
+        for(int bi=0; bi<nbx; ++bi)
+            for(int bj=0; bj<nby; ++bj){
+                long cells = (long)(std::min((bi+1)*B, nx-2) - bi*B) * (std::min((bj+1)*B, ny-2) - bj*B);
+                performed += cells << lvl[(size_t)bi*nby + bj];
+            }
+        opts.stats->cell_updates += performed;
+        opts.stats->cell_updates_global += (long)(nx-2)*(ny-2) * (long)std::ceil(dt/dt_min - 1e-9);
+        opts.stats->time += dt;
+    }
+    return dt;
+}
+
+double lts_update(FlowField& flow, double dt, double nu, const SolverOptions& opts){
+    return dispatch_physics([&](auto phys){
+        return lts_update_impl<decltype(phys)>(flow, dt, nu, opts);
+    });
+}
@@ -0,0 +1,16 @@
+#pragma once
+#include "solver.hpp"
+
+// Block-based local time stepping. The periodic interior is split into
+// opts.lts_block^2 blocks; each block advances with dt/2^level, level chosen
+// from its own CFL limit (at most opts.lts_levels levels, neighbours differ by
+// at most one). Face fluxes are computed at the rate of the finer neighbour
+// and accumulated into both cells, so the scheme stays conservative across
+// level interfaces.
+
+// Largest step the block hierarchy allows: min(max block dt, min block dt * 2^(levels-1))
+double compute_lts_timestep(const FlowField& flow, int levels, int block, double cfl_number = 0.2);
+
+// One local-time-stepping update of length dt (clamped to compute_lts_timestep);
+// returns the step taken. Fills opts.stats with performed and global-dt cell updates.
+double lts_update(FlowField& flow, double dt, double nu, const SolverOptions& opts);
@@ -1,59 +1,260 @@
 #include "solver.hpp"
+#include "solver3d.hpp"
 #include "physics.hpp"
 #include "io.hpp"
+#include "ct.hpp"
+#include "lts.hpp"
+#include "activity.hpp"
+#include "tracers.hpp"
+#include "rollback.hpp"
+#include "autotune.hpp"
+#include "config.hpp"
 
 #include <filesystem>
 #include <chrono>
 #include <iostream>
 #include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
 
-static std::string prepare_output_dir(){
+static std::string prepare_output_dir(const std::string& dir){
     namespace fs = std::filesystem;
-    fs::path base("Result");
+    fs::path base(dir);
     if(fs::exists(base) && !fs::is_empty(base)){
         auto ts = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-        fs::rename(base, "Result_"+std::to_string(ts));
+        fs::rename(base, dir+"_"+std::to_string(ts));
     }
     fs::create_directory(base);
-    return "Result";
+    return dir;
 }
 
-int main(){
-    const int nx=64, ny=64;
-    const double Lx=1.0,Ly=1.0, dx=Lx/(nx-1), dy=Ly/(ny-1);
-    const double nu=0.01;
-    const int max_steps=2000;
-    const int output_every=20;
-    const double t_end = 20.0;
-
-    std::string out_dir = prepare_output_dir();
+static void report_snapshots(const SnapshotWriter& out){
+    const SnapshotLayout& l = out.layout();
+    const double raw = (double)out.entries().size() * l.fields.size() * l.nx * l.ny * sizeof(double);
+    std::cout << "Snapshots: " << out.entries().size() << " records, "
+              << out.bytes_written() / 1048576.0 << " MB written ("
+              << raw / std::max<double>(out.bytes_written(), 1.0) << "x smaller than raw fields)\n";
+}
 
-    FlowField flow(nx,ny,dx,dy);
-    initialize_orszag_tang(flow);
-    //initialize_MHD_disk(flows[0]); // deterministic seed default
-    //add_divergence_error(flows[0], 0.1);
+// 3-D Orszag-Tang run: GLM cleaning, explicit diffusion, z mid-plane output
+static int run_3d(const RunConfig& cfg){
+    SolverOptions opts = cfg.solver;
+    std::string out_dir = prepare_output_dir(cfg.output_dir);
 
+    FlowField3D flow(cfg.nx, cfg.ny, cfg.nz, cfg.Lx/cfg.nx, cfg.Ly/cfg.ny, cfg.Lz/cfg.nz,
+                     0.0, 0.0, 0.0, cfg.out_of_core);
+    flow.slab_planes = cfg.ooc_slab;
+    initialize_orszag_tang_3d(flow);
+    std::unique_ptr<SnapshotWriter> snapshots;
+    if(cfg.output_format != OutputFormat::CSV)
+        snapshots = std::make_unique<SnapshotWriter>(out_dir, snapshot_layout_3d(flow), cfg.snapshot_keyframe,
+                                                     cfg.snapshot_bits);
 
     auto t0=std::chrono::high_resolution_clock::now();
     double t = 0.0;
-    for(int step=0; step<=max_steps && t < t_end; ++step){
-        // Use dynamic CFL-based timestep from the current flow state
-        double dt = compute_cfl_timestep(flow);
-        if(t + dt > t_end) dt = t_end - t;
+    for(int step=0; step<=cfg.max_steps && t < cfg.t_end; ++step){
+        double dt = std::min(compute_cfl_timestep_3d(flow, opts.cfl),
+                             compute_parabolic_timestep_3d(flow, cfg.nu));
+        if(t + dt > cfg.t_end) dt = cfg.t_end - t;
 
-        solve_MHD(flow, dt, nu);
+        solve_MHD_3d(flow, dt, cfg.nu, opts);
         t += dt;
 
-        if(step%output_every==0){
-            auto [max_divB, L1_divB] = compute_divergence_errors(flow);
+        if(step%cfg.output_every==0){
+            auto [max_divB, L1_divB] = compute_divergence_errors_3d(flow);
             std::cout << "step "<< std::setw(4) << step << " dt="<<dt
                       << " max_divB=" << max_divB
                       << " L1_divB=" << L1_divB << "\n";
-            save_flow_MHD(flow,out_dir,step);
+            if(cfg.output_format != OutputFormat::Snapshots) save_flow_MHD_3d(flow,out_dir,step);
+            if(snapshots) save_flow_snapshot_3d(*snapshots, flow, step, t);
+        }
+    }
+    auto t1=std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = t1 - t0;
+    std::cout<<"Total time "<<elapsed.count()<<" s\n";
+    if(snapshots) report_snapshots(*snapshots);
+    std::cout << "Memory: " << huge_page_report() << "\n";
+    return 0;
+}
+
+int main(int argc, char** argv){
+    RunConfig cfg;
+    try {
+        cfg = load_config(argc, argv);
+    } catch(const std::invalid_argument& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    print_config(cfg, std::cout);
+
+    const int nx=cfg.nx, ny=cfg.ny;
+    const double dx=cfg.Lx/(nx-1), dy=cfg.Ly/(ny-1);
+    const double nu=cfg.nu;
+    set_exec_backend(cfg.backend, cfg.threads);
+    set_huge_pages(cfg.huge_pages);
+    set_physics_params(cfg.physics);
+    if(cfg.nz > 1) return run_3d(cfg);
+
+    SolverOptions opts = cfg.solver;
+    SolverStats stats;
+    opts.stats = &stats;
+    ActivityMask activity;
+    opts.activity = &activity;
+    const bool use_lts = opts.lts_levels > 1 && opts.divb != DivBScheme::CT;
+
+    std::string out_dir = prepare_output_dir(cfg.output_dir);
+
+    FlowField flow(nx,ny,dx,dy,0.0,0.0,cfg.out_of_core);
+    if(cfg.init == "disk") initialize_MHD_disk(flow, cfg.seed);
+    else if(cfg.init == "blast") initialize_blast(flow);
+#ifdef MHD_2P5D
+    else if(cfg.init == "alfven") initialize_alfven_wave(flow);
+#endif
+    else                   initialize_orszag_tang(flow);
+    if(cfg.divergence_error > 0.0) add_divergence_error(flow, cfg.divergence_error);
+    if(cfg.autotune != Autotune::Off){
+        const std::string cache = cfg.autotune_cache.empty() ? autotune_default_cache()
+                                : cfg.autotune_cache == "none" ? "" : cfg.autotune_cache;
+        TuneResult tuned = autotune(flow, nu, opts, cfg.threads, cache, cfg.autotune_steps,
+                                    cfg.autotune == Autotune::Refresh);
+        apply_tuning(tuned.choice, opts);
+        std::cout << "[Autotune] threads=" << tuned.choice.threads
+                  << " fixed_size=" << (tuned.choice.fixed_size ? "true" : "false");
+        if(tuned.choice.tile > 0)
+            std::cout << (use_lts ? " lts_block=" : " activity_tile=") << tuned.choice.tile;
+        std::cout << ": " << tuned.choice.ms_per_step << " ms/step, ";
+        if(tuned.cached) std::cout << "cached";
+        else             std::cout << "best of " << tuned.candidates << " candidates";
+        std::cout << "\n";
+    }
+    std::unique_ptr<SnapshotWriter> snapshots;
+    if(cfg.output_format != OutputFormat::CSV)
+        snapshots = std::make_unique<SnapshotWriter>(out_dir, snapshot_layout(flow), cfg.snapshot_keyframe,
+                                                     cfg.snapshot_bits);
+    std::unique_ptr<Tracers> tracers;
+    std::unique_ptr<TrajectoryWriter> trajectories;
+    if(cfg.tracers > 0){
+        tracers = std::make_unique<Tracers>(flow, cfg.tracers, cfg.seed);
+        if(cfg.tracer_sort > 0) tracers->sort(flow);
+        trajectories = std::make_unique<TrajectoryWriter>(out_dir, tracers->size());
+    }
+    // Unhealthy steps go back to the last checkpoint and retry with a smaller CFL number.
+    // Step lines are held back until no checkpoint before them is left, so a
+    // retried step is printed once; the snapshot and tracer files are cut back.
+    std::unique_ptr<RollbackRing> rollback;
+    StepHealth health;
+    double cfl_scale = 1.0;
+    long rollbacks = 0;
+    std::string held;            // step lines not yet printed
+    size_t printed = 0;          // bytes of step lines printed
+    auto output_mark = [&]{
+        return OutputMark{snapshots ? snapshots->entries().size() : 0,
+                          trajectories ? trajectories->frames() : 0, printed + held.size()};
+    };
+    auto print = [&](const std::string& line){
+        if(rollback) held += line;
+        else         std::cout << line;
+    };
+    if(cfg.rollback_depth > 0){
+        rollback = std::make_unique<RollbackRing>(cfg.rollback_depth);
+        rollback->save(flow, -1, 0.0, tracers.get(), output_mark(), &stats);
+        opts.health = &health;
+    }
+
+    auto t0=std::chrono::high_resolution_clock::now();
+    double t = 0.0;
+    for(int step=0; step<=cfg.max_steps && t < cfg.t_end; ++step){
+        opts.cfl = cfg.solver.cfl * cfl_scale;
+        // Use dynamic CFL-based timestep from the current flow state
+        double dt = use_lts ? compute_lts_timestep(flow, opts.lts_levels, opts.lts_block, opts.cfl)
+                            : compute_cfl_timestep(flow, opts.cfl);
+        if(opts.diffusion == DiffusionScheme::Explicit)
+            dt = std::min(dt, compute_parabolic_timestep(flow, nu));
+        if(t + dt > cfg.t_end) dt = cfg.t_end - t;
+
+        if(tracers) tracers->predict(flow, dt);
+        solve_MHD(flow, dt, nu, opts);
+        if(tracers) tracers->correct(flow, dt);
+        if(rollback && !health.ok()){
+            const int failed = step;
+            OutputMark mark;
+            if(!rollback->restore(flow, step, t, tracers.get(), &mark, &stats)){
+                std::cout << held;
+                std::cerr << "Step " << failed << " is unhealthy and no checkpoint is left to retry from; stopping\n";
+                return 2;
+            }
+            if(snapshots) snapshots->truncate(mark.snapshots);
+            if(trajectories) trajectories->truncate(mark.frames);
+            held.resize(mark.log - printed);
+            cfl_scale *= cfg.rollback_cfl;
+            activity = ActivityMask();
+            ++rollbacks;
+            std::cerr << "Rollback: step " << failed << " left " << health.nonfinite << " non-finite, "
+                      << health.negative_pressure << " negative-pressure and " << health.floored
+                      << " floored cells; retrying from step " << step+1
+                      << " with cfl=" << cfg.solver.cfl * cfl_scale << "\n";
+            continue;
+        }
+        t += dt;
+
+        if(step%cfg.output_every==0){
+            auto [max_divB, L1_divB] = (opts.divb == DivBScheme::CT)
+                ? compute_face_divergence_errors(flow)
+                : compute_divergence_errors(flow);
+            std::ostringstream line;
+            line << "step "<< std::setw(4) << step << " dt="<<dt
+                 << " max_divB=" << max_divB
+                 << " L1_divB=" << L1_divB << "\n";
+            print(line.str());
+            if(cfg.output_format != OutputFormat::Snapshots) save_flow_MHD(flow,out_dir,step);
+            if(snapshots) save_flow_snapshot(*snapshots, flow, step, t);
+        }
+        for(const OutputSpec& stream : cfg.outputs)
+            if(step%stream.every==0) save_flow_MHD(flow, stream, out_dir, step);
+        if(tracers){
+            if(step%cfg.tracer_every==0) trajectories->append(*tracers, step, t);
+            if(cfg.tracer_sort > 0 && (step+1)%cfg.tracer_sort==0) tracers->sort(flow);
+        }
+        if(rollback && (step+1)%cfg.rollback_every==0){
+            rollback->save(flow, step, t, tracers.get(), output_mark(), &stats);
+            cfl_scale = std::min(1.0, cfl_scale / cfg.rollback_cfl);
+            const size_t settled = rollback->oldest_mark().log - printed;
+            std::cout << held.substr(0, settled);
+            held.erase(0, settled);
+            printed += settled;
         }
     }
+    std::cout << held;
     auto t1=std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> elapsed = t1 - t0;
     std::cout<<"Total time "<<elapsed.count()<<" s\n";
+    if(snapshots) report_snapshots(*snapshots);
+    if(rollbacks > 0)
+        std::cout << "Rollbacks: " << rollbacks << " unhealthy steps retried, final cfl=" << opts.cfl << "\n";
+    if(tracers)
+        std::cout << "Tracers: " << tracers->size() << " particles, " << trajectories->frames()
+                  << " frames in " << out_dir << "/tracers.bin\n";
+    if(use_lts && stats.time > 0.0)
+        std::cout << "LTS cell updates " << stats.cell_updates << " vs " << stats.cell_updates_global
+                  << " with global dt; saved " << (stats.cell_updates_global - stats.cell_updates)/stats.time
+                  << " per unit time\n";
+    if(opts.split && !use_lts)
+        std::cout << "Positivity limiter: off under split, " << stats.floored_cells
+                  << " sweep cell updates floored\n";
+    else if(opts.positivity && !use_lts)
+        std::cout << "Positivity limiter: " << stats.limited_faces << " faces limited, "
+                  << stats.floored_cells << " cells floored\n";
+    if(opts.activity_tol > 0.0 && !use_lts)
+        std::cout << "Activity mask: " << stats.skipped_cells << " of " << stats.cell_updates
+                  << " cell updates reused stored fluxes\n";
+    if(opts.riemann != RiemannSolver::HLL && !use_lts){
+        const long faces = stats.rusanov_faces + stats.hll_faces;
+        std::cout << "Riemann solver: " << stats.rusanov_faces << " Rusanov, " << stats.hll_faces << " HLL face fluxes ("
+                  << (faces > 0 ? 100.0*stats.hll_faces/faces : 0.0) << "% HLL)\n";
+    }
+    std::cout << "Memory: " << huge_page_report() << "\n";
     return 0;
 }
@@ -0,0 +1,179 @@
+#include "multigrid.hpp"
+#include "fft.hpp"
+#include "exec.hpp"
+#include <functional>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Transfer along one axis between n fine and N coarse cells of the same
+// periodic length. Prolongation is linear interpolation between cell
+// centres: fine cell i takes (1-w[i])*c[lo[i]] + w[i]*c[lo[i]+1], with coarse
+// ghosts at 0 and N+1. Restriction averages the two fine cells of a coarse
+// one when n = 2N. For odd n the coarse cells do not nest, and restriction is
+// the transpose of the interpolation scaled by N/n, so constants map to
+// constants.
+struct Transfer {
+    std::vector<int> lo;
+    std::vector<double> w;
+    std::vector<std::vector<std::pair<int, double>>> restrict_from;   // per coarse cell: fine cell, weight
+
+    Transfer(int n, int N) : lo(n+1), w(n+1), restrict_from(N+1) {
+        for(int i=1;i<=n;++i){
+            double s = (i - 0.5)*N/n + 0.5;
+            lo[i] = (int)std::floor(s);
+            w[i] = s - lo[i];
+        }
+        auto wrap = [N](int I){ return I < 1 ? I + N : I > N ? I - N : I; };
+        for(int i=1;i<=n;++i){
+            if(n == 2*N){
+                restrict_from[(i+1)/2].emplace_back(i, 0.5);
+                continue;
+            }
+            restrict_from[wrap(lo[i])].emplace_back(i, (1.0 - w[i])*N/n);
+            restrict_from[wrap(lo[i]+1)].emplace_back(i, w[i]*N/n);
+        }
+    }
+};
+
+struct Level {
+    Grid x, b, r;
+    std::vector<Transfer> to_coarse;   // x and y transfers to the next level, if any
+    Level(int n, int m, double dx, double dy)
+        : x(n+2, m+2, dx, dy), b(n+2, m+2, dx, dy), r(n+2, m+2, dx, dy) {}
+};
+
+void fill_ghosts(Grid& g){
+    exec::for_each(1, g.ny-1, [&](long j){
+        g.data[0][j]      = g.data[g.nx-2][j];
+        g.data[g.nx-1][j] = g.data[1][j];
+    });
+    exec::for_each(0, g.nx, [&](long i){
+        g.data[i][0]      = g.data[i][g.ny-2];
+        g.data[i][g.ny-1] = g.data[i][1];
+    });
+}
+
+void smooth_rbgs(Level& L, double alpha, int sweeps){
+    Grid& x = L.x;
+    const double ax = alpha/(x.dx*x.dx), ay = alpha/(x.dy*x.dy);
+    const double inv_diag = 1.0/(1.0 + 2.0*ax + 2.0*ay);
+    for(int s=0;s<sweeps;++s){
+        for(int color=0;color<2;++color){
+            exec::for_each(1, x.nx-1, [&](long i){
+                for(int j=1 + (i + 1 + color)%2; j<x.ny-1; j+=2)
+                    x.data[i][j] = (L.b.data[i][j]
+                                    + ax*(x.data[i+1][j] + x.data[i-1][j])
+                                    + ay*(x.data[i][j+1] + x.data[i][j-1])) * inv_diag;
+            });
+            fill_ghosts(x);
+        }
+    }
+}
+
+// r = b - (I - alpha*lap) x; returns the L2 norm of r
+double residual(Level& L, double alpha){
+    Grid& x = L.x;
+    const double ax = alpha/(x.dx*x.dx), ay = alpha/(x.dy*x.dy);
+    double norm2 = exec::reduce_2d(1, x.nx-1, 1, x.ny-1, 0.0, std::plus<double>(), [&](int i, int j){
+        double Ax = (1.0 + 2.0*ax + 2.0*ay)*x.data[i][j]
+                  - ax*(x.data[i+1][j] + x.data[i-1][j])
+                  - ay*(x.data[i][j+1] + x.data[i][j-1]);
+        L.r.data[i][j] = L.b.data[i][j] - Ax;
+        return L.r.data[i][j]*L.r.data[i][j];
+    });
+    return std::sqrt(norm2);
+}
+
+// Exact periodic solve with the FFT symbol of the 5-point operator
+void solve_coarsest(Level& L, double alpha){
+    const int n = L.x.nx-2, m = L.x.ny-2;
+    std::vector<cplx> bh((size_t)n*m);
+    for(int i=0;i<n;++i)
+        for(int j=0;j<m;++j)
+            bh[(size_t)i*m + j] = L.b.data[i+1][j+1];
+    fft_2d(bh, n, m, false);
+    for(int i=0;i<n;++i)
+        for(int j=0;j<m;++j){
+            double sx = std::sin(M_PI*i/n), sy = std::sin(M_PI*j/m);
+            double sym = 1.0 + alpha*(4.0*sx*sx/(L.x.dx*L.x.dx) + 4.0*sy*sy/(L.x.dy*L.x.dy));
+            bh[(size_t)i*m + j] /= sym;
+        }
+    fft_2d(bh, n, m, true);
+    for(int i=0;i<n;++i)
+        for(int j=0;j<m;++j)
+            L.x.data[i+1][j+1] = bh[(size_t)i*m + j].real();
+    fill_ghosts(L.x);
+}
+
+void vcycle(std::vector<Level>& levels, size_t l, double alpha){
+    Level& F = levels[l];
+    if(l + 1 == levels.size()){
+        solve_coarsest(F, alpha);
+        return;
+    }
+    Level& C = levels[l+1];
+
+    smooth_rbgs(F, alpha, 2);
+    residual(F, alpha);
+
+    // Restriction and prolongation, tensor products of the per-axis transfers
+    const Transfer& tx = F.to_coarse[0];
+    const Transfer& ty = F.to_coarse[1];
+    exec::for_2d(1, C.b.nx-1, 1, C.b.ny-1, [&](int I, int J){
+        double sum = 0.0;
+        for(auto [i, wi] : tx.restrict_from[I])
+            for(auto [j, wj] : ty.restrict_from[J])
+                sum += wi*wj*F.r.data[i][j];
+        C.b.data[I][J] = sum;
+        C.x.data[I][J] = 0.0;
+    });
+    fill_ghosts(C.x);
+
+    vcycle(levels, l+1, alpha);
+
+    exec::for_2d(1, F.x.nx-1, 1, F.x.ny-1, [&](int i, int j){
+        const int I = tx.lo[i], J = ty.lo[j];
+        const double wx = tx.w[i], wy = ty.w[j];
+        F.x.data[i][j] += (1.0-wx)*((1.0-wy)*C.x.data[I][J]   + wy*C.x.data[I][J+1])
+                        +      wx *((1.0-wy)*C.x.data[I+1][J] + wy*C.x.data[I+1][J+1]);
+    });
+    fill_ghosts(F.x);
+
+    smooth_rbgs(F, alpha, 2);
+}
+
+} // namespace
+
+int mg_solve_helmholtz(Grid& x, const Grid& b, double alpha, double tol, int max_cycles){
+    std::vector<Level> levels;
+    int n = x.nx-2, m = x.ny-2;
+    double dx = x.dx, dy = x.dy;
+    levels.emplace_back(n, m, dx, dy);
+    while(n >= 8 && m >= 8){
+        const int N = (n+1)/2, M = (m+1)/2;
+        levels.back().to_coarse = {Transfer(n, N), Transfer(m, M)};
+        dx *= (double)n/N; dy *= (double)m/M;
+        n = N; m = M;
+        levels.emplace_back(n, m, dx, dy);
+    }
+
+    Level& fine = levels[0];
+    fine.x.data = x.data;
+    fine.b.data = b.data;
+    fill_ghosts(fine.x);
+
+    double bnorm = std::sqrt(exec::reduce_2d(1, b.nx-1, 1, b.ny-1, 0.0, std::plus<double>(), [&](int i, int j){
+        return b.data[i][j]*b.data[i][j];
+    }));
+
+    int cycles = 0;
+    while(cycles < max_cycles && residual(fine, alpha) > tol*std::max(bnorm, 1e-300)){
+        vcycle(levels, 0, alpha);
+        ++cycles;
+    }
+    x.data = fine.x.data;
+    return cycles;
+}
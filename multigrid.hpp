@@ -0,0 +1,11 @@
+#pragma once
+#include "grid.hpp"
+
+// Matrix-free geometric multigrid for (I - alpha*lap) x = b on the periodic
+// interior of a Grid (one ghost layer, as in the solver). V(2,2) cycles with a
+// red-black Gauss-Seidel smoother; each level halves the interior sizes
+// (rounding up, so odd sizes coarsen too) until one of them drops below 8, and
+// the coarsest level is solved exactly with an FFT.
+// x holds the initial guess on entry. Returns the number of V-cycles used.
+int mg_solve_helmholtz(Grid& x, const Grid& b, double alpha,
+                       double tol = 1e-10, int max_cycles = 20);
@@ -1,6 +1,19 @@
 #pragma once
 #include "grid.hpp"
+#include "grid3d.hpp"
 void initialize_MHD_disk(FlowField& flow, int seed = 12345);
 void add_divergence_error(FlowField& flow, double amplitude = 0.1); 
 void initialize_orszag_tang(FlowField& flow);  // Add this line
+// MHD blast wave: rho = 1, p = p_in inside r < 0.1 around the centre of the
+// periodic interior and 0.1 outside, uniform B = B0 (1, 1)/sqrt(2)
+void initialize_blast(FlowField& flow, double p_in = 100.0, double B0 = 1.0);
+#ifdef MHD_2P5D
+// Circularly polarised Alfven wave along x (2.5-D build): rho = 1, p = 0.1,
+// Bx = 1, (By, Bz) = amplitude (sin, cos) over one wavelength of the
+// periodic interior, travelling in +x with speed 1
+void initialize_alfven_wave(FlowField& flow, double amplitude = 0.1);
+#endif
 
+// 3-D Orszag-Tang on [0,1]^3: the 2-D vortex with a z-dependent velocity
+// perturbation of amplitude 0.2, ghosts filled
+void initialize_orszag_tang_3d(FlowField3D& flow);
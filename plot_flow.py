@@ -1,34 +1,27 @@
 """Create an animation of the MHD flow fields.
 
-The script reads CSV output files generated by ``main.cpp`` and
+The script reads the output generated by ``main.cpp`` and
 produces ``Result/flow_animation.mp4`` visualising the density,
 pressure, velocity and magnetic fields over time.
 """
 
-import glob
-import re
 import numpy as np
-import pandas as pd
 import matplotlib.pyplot as plt
 from matplotlib.animation import FuncAnimation
+from snapshots import open_result
 
-# Discover available steps from density output files
-rho_files = glob.glob("Result/out_rho_*.csv")
-if not rho_files:
+# Discover available steps (snapshot container or CSV files)
+result = open_result("Result")
+if not result.steps:
     raise SystemExit("No output files found in Result/")
-steps = sorted(int(re.findall(r"_rho_(\d+).csv", f)[0]) for f in rho_files)
+steps = result.steps
 
-# Infer grid from first file
-sample = pd.read_csv(rho_files[0], header=None)
-xs = np.unique(sample[0])
-ys = np.unique(sample[1])
-NX, NY = len(xs), len(ys)
+xs, ys = result.xs, result.ys
 X, Y = np.meshgrid(xs, ys)
 
 
 def load(step, prefix):
-    df = pd.read_csv(f"Result/out_{prefix}_{step}.csv", header=None)
-    return df[2].values.reshape(NX, NY).T
+    return result.read(step, prefix).T
 
 # Create figure with four subplots
 fig, ((ax_rho, ax_p), (ax_vel, ax_B)) = plt.subplots(2, 2, figsize=(12, 10))
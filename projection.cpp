@@ -0,0 +1,59 @@
+#include "projection.hpp"
+#include "fft.hpp"
+#include "exec.hpp"
+#include <cmath>
+#include <vector>
+
+void project_divergence_free(FlowField& flow){
+    Grid& bx = flow.bx;
+    Grid& by = flow.by;
+    // Periodic interior cells 1..nx-2 / 1..ny-2; rows 0 and nx-1 are ghost copies
+    const int nx = bx.nx - 2, ny = bx.ny - 2;
+
+    std::vector<cplx> bxh((size_t)nx*ny), byh((size_t)nx*ny);
+    exec::for_2d(0, nx, 0, ny, [&](int i, int j){
+        bxh[(size_t)i*ny + j] = bx.data[i+1][j+1];
+        byh[(size_t)i*ny + j] = by.data[i+1][j+1];
+    });
+
+    fft_2d(bxh, nx, ny, false);
+    fft_2d(byh, nx, ny, false);
+
+    // Symbol of the centred difference: d/dx -> i*sin(kx*dx)/dx
+    exec::for_2d(0, nx, 0, ny, [&](int i, int j){
+        double sx = std::sin(2.0*M_PI*i/nx) / bx.dx;
+        double sy = std::sin(2.0*M_PI*j/ny) / by.dy;
+        double k2 = sx*sx + sy*sy;
+        if(k2 < 1e-12) return;   // mean and Nyquist modes carry no centred divergence
+        size_t idx = (size_t)i*ny + j;
+        cplx div = cplx(0.0, sx) * bxh[idx] + cplx(0.0, sy) * byh[idx];
+        cplx phi = -div / k2;
+        bxh[idx] -= cplx(0.0, sx) * phi;
+        byh[idx] -= cplx(0.0, sy) * phi;
+    });
+
+    fft_2d(bxh, nx, ny, true);
+    fft_2d(byh, nx, ny, true);
+
+    exec::for_2d(0, nx, 0, ny, [&](int i, int j){
+        double bx_old = bx.data[i+1][j+1], by_old = by.data[i+1][j+1];
+        double bx_new = bxh[(size_t)i*ny + j].real();
+        double by_new = byh[(size_t)i*ny + j].real();
+        bx.data[i+1][j+1] = bx_new;
+        by.data[i+1][j+1] = by_new;
+        flow.e.data[i+1][j+1] += 0.5*(bx_new*bx_new + by_new*by_new)
+                               - 0.5*(bx_old*bx_old + by_old*by_old);
+    });
+
+    // Periodic ghosts
+    exec::for_each(0, bx.ny, [&](long j){
+        bx.data[0][j] = bx.data[bx.nx-2][j];  bx.data[bx.nx-1][j] = bx.data[1][j];
+        by.data[0][j] = by.data[bx.nx-2][j];  by.data[bx.nx-1][j] = by.data[1][j];
+        flow.e.data[0][j] = flow.e.data[bx.nx-2][j];  flow.e.data[bx.nx-1][j] = flow.e.data[1][j];
+    });
+    exec::for_each(0, bx.nx, [&](long i){
+        bx.data[i][0] = bx.data[i][bx.ny-2];  bx.data[i][bx.ny-1] = bx.data[i][1];
+        by.data[i][0] = by.data[i][bx.ny-2];  by.data[i][bx.ny-1] = by.data[i][1];
+        flow.e.data[i][0] = flow.e.data[i][bx.ny-2];  flow.e.data[i][bx.ny-1] = flow.e.data[i][1];
+    });
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include "grid.hpp"
+
+// Exact projection cleaning on the periodic interior: solves lap(phi) = div B
+// with a 2-D FFT and sets B -= grad(phi), using the same centred stencil as
+// compute_divergence_errors so the reported div B drops to round-off.
+// Pressure is kept, total energy absorbs the magnetic energy change.
+void project_divergence_free(FlowField& flow);
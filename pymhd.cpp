@@ -0,0 +1,174 @@
+// Python extension module "mhd": in-process access to FlowField and the solver.
+// Field arrays are zero-copy NumPy views of the Grid storage (ghost layer
+// included, shape (nx, ny)) that keep their FlowField alive.
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include <algorithm>
+
+#include "grid.hpp"
+#include "physics.hpp"
+#include "solver.hpp"
+#include "ct.hpp"
+#include "activity.hpp"
+
+namespace py = pybind11;
+
+// Owning copy of a Grid that is not part of a FlowField
+static py::array_t<double> grid_copy(const Grid& g){
+    py::array_t<double> a({(py::ssize_t)g.nx, (py::ssize_t)g.ny});
+    std::copy(g.data.ptr(), g.data.ptr() + g.data.size(), a.mutable_data());
+    return a;
+}
+
+static py::array_t<double> grid_view(Grid& g, py::handle owner){
+    return py::array_t<double>(
+        {(py::ssize_t)g.nx, (py::ssize_t)g.ny},
+        {(py::ssize_t)(sizeof(double)*g.ny), (py::ssize_t)sizeof(double)},
+        g.data.ptr(), owner);
+}
+
+template <Grid FlowField::*F>
+static py::array_t<double> field_view(py::object self){
+    return grid_view(self.cast<FlowField&>().*F, self);
+}
+
+PYBIND11_MODULE(mhd, m){
+    m.doc() = "2-D GLM/CT MHD solver";
+
+    py::enum_<DivBScheme>(m, "DivBScheme")
+        .value("GLM", DivBScheme::GLM)
+        .value("CT", DivBScheme::CT)
+        .value("Projection", DivBScheme::Projection);
+
+    py::enum_<DiffusionScheme>(m, "DiffusionScheme")
+        .value("Explicit", DiffusionScheme::Explicit)
+        .value("RKL2", DiffusionScheme::RKL2)
+        .value("CrankNicolson", DiffusionScheme::CrankNicolson)
+        .value("BackwardEuler", DiffusionScheme::BackwardEuler);
+
+    py::enum_<RiemannSolver>(m, "RiemannSolver")
+        .value("HLL", RiemannSolver::HLL)
+        .value("Rusanov", RiemannSolver::Rusanov)
+        .value("Hybrid", RiemannSolver::Hybrid);
+
+    py::enum_<HugePages>(m, "HugePages")
+        .value("Off", HugePages::Off)
+        .value("Transparent", HugePages::Transparent)
+        .value("Auto", HugePages::Auto);
+
+    py::class_<SolverStats>(m, "SolverStats")
+        .def(py::init<>())
+        .def_readonly("cell_updates", &SolverStats::cell_updates)
+        .def_readonly("cell_updates_global", &SolverStats::cell_updates_global)
+        .def_readonly("time", &SolverStats::time)
+        .def_readonly("limited_faces", &SolverStats::limited_faces)
+        .def_readonly("floored_cells", &SolverStats::floored_cells)
+        .def_readonly("skipped_cells", &SolverStats::skipped_cells)
+        .def_readonly("rusanov_faces", &SolverStats::rusanov_faces)
+        .def_readonly("hll_faces", &SolverStats::hll_faces);
+
+    py::class_<StepHealth>(m, "StepHealth")
+        .def(py::init<>())
+        .def_readonly("nonfinite", &StepHealth::nonfinite)
+        .def_readonly("negative_pressure", &StepHealth::negative_pressure)
+        .def_readonly("floored", &StepHealth::floored)
+        .def("ok", &StepHealth::ok);
+
+    py::class_<SolverOptions>(m, "SolverOptions")
+        .def(py::init<>())
+        .def_readwrite("cfl", &SolverOptions::cfl)
+        .def_readwrite("divb", &SolverOptions::divb)
+        .def_readwrite("projection_every", &SolverOptions::projection_every)
+        .def_readwrite("diffusion", &SolverOptions::diffusion)
+        .def_readwrite("lts_levels", &SolverOptions::lts_levels)
+        .def_readwrite("lts_block", &SolverOptions::lts_block)
+        .def_readwrite("positivity", &SolverOptions::positivity)
+        .def_readwrite("fixed_size", &SolverOptions::fixed_size)
+        .def_readwrite("activity_tol", &SolverOptions::activity_tol)
+        .def_readwrite("activity_tile", &SolverOptions::activity_tile)
+        .def_readwrite("riemann", &SolverOptions::riemann)
+        .def_readwrite("riemann_threshold", &SolverOptions::riemann_threshold)
+        .def_readwrite("split", &SolverOptions::split)
+        .def_readwrite("split_transpose", &SolverOptions::split_transpose)
+        // Counters the solver fills in; the options keep the assigned object alive
+        .def_property("stats", [](const SolverOptions& o){ return o.stats; },
+                      [](SolverOptions& o, SolverStats* s){ o.stats = s; }, py::keep_alive<1, 2>())
+        .def_property("health", [](const SolverOptions& o){ return o.health; },
+                      [](SolverOptions& o, StepHealth* h){ o.health = h; }, py::keep_alive<1, 2>());
+
+    py::class_<FlowField>(m, "FlowField")
+        .def(py::init<int,int,double,double,double,double>(),
+             py::arg("nx"), py::arg("ny"), py::arg("dx"), py::arg("dy"),
+             py::arg("x0") = 0.0, py::arg("y0") = 0.0)
+        .def_property_readonly("nx", [](const FlowField& f){ return f.rho.nx; })
+        .def_property_readonly("ny", [](const FlowField& f){ return f.rho.ny; })
+        .def_property_readonly("dx", [](const FlowField& f){ return f.rho.dx; })
+        .def_property_readonly("dy", [](const FlowField& f){ return f.rho.dy; })
+        .def_readonly("steps", &FlowField::steps)
+        .def_property_readonly("rho", &field_view<&FlowField::rho>)
+        .def_property_readonly("u",   &field_view<&FlowField::u>)
+        .def_property_readonly("v",   &field_view<&FlowField::v>)
+        .def_property_readonly("p",   &field_view<&FlowField::p>)
+        .def_property_readonly("e",   &field_view<&FlowField::e>)
+        .def_property_readonly("bx",  &field_view<&FlowField::bx>)
+        .def_property_readonly("by",  &field_view<&FlowField::by>)
+        .def_property_readonly("psi", &field_view<&FlowField::psi>)
+        .def_property_readonly("bxf", &field_view<&FlowField::bxf>)
+        .def_property_readonly("byf", &field_view<&FlowField::byf>)
+#ifdef MHD_2P5D
+        .def_property_readonly("w",   &field_view<&FlowField::w>)
+        .def_property_readonly("bz",  &field_view<&FlowField::bz>)
+#endif
+        ;
+
+    m.def("initialize_orszag_tang", &initialize_orszag_tang, py::arg("flow"),
+          py::call_guard<py::gil_scoped_release>());
+    m.def("initialize_MHD_disk", &initialize_MHD_disk, py::arg("flow"), py::arg("seed") = 12345,
+          py::call_guard<py::gil_scoped_release>());
+    m.def("initialize_blast", &initialize_blast, py::arg("flow"), py::arg("p_in") = 100.0, py::arg("B0") = 1.0,
+          py::call_guard<py::gil_scoped_release>());
+#ifdef MHD_2P5D
+    m.def("initialize_alfven_wave", &initialize_alfven_wave, py::arg("flow"), py::arg("amplitude") = 0.1,
+          py::call_guard<py::gil_scoped_release>());
+#endif
+    m.def("add_divergence_error", &add_divergence_error, py::arg("flow"), py::arg("amplitude") = 0.1,
+          py::call_guard<py::gil_scoped_release>());
+
+    m.def("solve_MHD", [](FlowField& flow, double dt, double nu, const SolverOptions& opts){
+              solve_MHD(flow, dt, nu, opts);
+          }, py::arg("flow"), py::arg("dt"), py::arg("nu"), py::arg("opts") = SolverOptions(),
+          py::call_guard<py::gil_scoped_release>());
+
+    // Several CFL-limited steps without returning to Python; returns the time advanced.
+    // The activity mask (opts.activity_tol > 0) lives for the duration of one call.
+    m.def("advance", [](FlowField& flow, int steps, double nu, SolverOptions opts, double cfl_number){
+              ActivityMask activity;
+              opts.activity = &activity;
+              double t = 0.0;
+              for(int s = 0; s < steps; ++s){
+                  double dt = compute_cfl_timestep(flow, cfl_number);
+                  if(opts.diffusion == DiffusionScheme::Explicit)
+                      dt = std::min(dt, compute_parabolic_timestep(flow, nu));
+                  solve_MHD(flow, dt, nu, opts);
+                  t += dt;
+              }
+              return t;
+          }, py::arg("flow"), py::arg("steps"), py::arg("nu"), py::arg("opts") = SolverOptions(),
+          py::arg("cfl_number") = 0.2, py::call_guard<py::gil_scoped_release>());
+
+    m.def("compute_cfl_timestep", &compute_cfl_timestep, py::arg("flow"), py::arg("cfl_number") = 0.2,
+          py::call_guard<py::gil_scoped_release>());
+    m.def("compute_divergence_errors", &compute_divergence_errors, py::arg("flow"),
+          py::call_guard<py::gil_scoped_release>());
+    m.def("compute_face_divergence_errors", &compute_face_divergence_errors, py::arg("flow"),
+          py::call_guard<py::gil_scoped_release>());
+    m.def("compute_current_density", [](const FlowField& flow){ return grid_copy(compute_current_density(flow)); },
+          py::arg("flow"));
+    m.def("compute_vorticity", [](const FlowField& flow){ return grid_copy(compute_vorticity(flow)); },
+          py::arg("flow"));
+    m.def("set_huge_pages", &set_huge_pages, py::arg("mode"),
+          "Backing of field arrays allocated from now on");
+    m.def("huge_page_report", &huge_page_report);
+}
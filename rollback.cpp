@@ -0,0 +1,42 @@
+#include "rollback.hpp"
+#include <algorithm>
+
+RollbackRing::RollbackRing(int depth, int tries)
+    : depth_(std::max(depth, 1)), tries_(std::max(tries, 1)) { slots_.reserve(depth_); }
+
+void RollbackRing::save(const FlowField& flow, int step, double t, const Tracers* tracers,
+                        const OutputMark& mark, const SolverStats* stats){
+    const int slot = (newest_ + 1) % depth_;
+    if(slot == (int)slots_.size()) slots_.emplace_back(flow);
+    else                           slots_[slot].flow = flow;
+    Entry& e = slots_[slot];
+    if(tracers){
+        if(e.tracers) *e.tracers = *tracers;
+        else          e.tracers = std::make_unique<Tracers>(*tracers);
+    }
+    e.step = step;
+    e.t = t;
+    e.restores = 0;
+    e.mark = mark;
+    if(stats) e.stats = *stats;
+    newest_ = slot;
+    count_ = std::min(count_ + 1, depth_);
+}
+
+bool RollbackRing::restore(FlowField& flow, int& step, double& t, Tracers* tracers, OutputMark* mark,
+                           SolverStats* stats){
+    while(count_ > 0 && slots_[newest_].restores >= tries_){
+        newest_ = (newest_ + depth_ - 1) % depth_;
+        --count_;
+    }
+    if(count_ == 0) return false;
+    Entry& e = slots_[newest_];
+    ++e.restores;
+    flow = e.flow;
+    if(tracers && e.tracers) *tracers = *e.tracers;
+    step = e.step;
+    t = e.t;
+    if(mark) *mark = e.mark;
+    if(stats) *stats = e.stats;
+    return true;
+}
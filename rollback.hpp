@@ -0,0 +1,55 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "grid.hpp"
+#include "solver.hpp"
+#include "tracers.hpp"
+
+// Ring of in-memory checkpoints of a 2-D run, so a step that fails the
+// StepHealth check can be undone instead of ending the run. save() copies the
+// state (and the tracers, if any) into the oldest slot; the buffers of a slot
+// are reused once it exists, so a checkpoint costs one copy of the fields.
+//
+// Each checkpoint also records how much output the run had written when it
+// was taken (OutputMark), so a restore can cut the output streams back to it,
+// and the run's SolverStats, so the counters of undone steps are dropped.
+//
+// restore() goes back to the newest checkpoint. A checkpoint that has already
+// been restored `tries` times is dropped first, so repeated failures from the
+// same point fall back to older states until the ring is empty.
+struct OutputMark {
+    size_t snapshots = 0;   // records in the snapshot container
+    long frames = 0;        // tracer trajectory frames
+    size_t log = 0;         // bytes of step lines printed or held back
+};
+
+class RollbackRing {
+public:
+    RollbackRing(int depth, int tries = 2);
+
+    void save(const FlowField& flow, int step, double t, const Tracers* tracers = nullptr,
+              const OutputMark& mark = {}, const SolverStats* stats = nullptr);
+    // Restores the newest usable checkpoint into flow (and tracers, stats) and
+    // sets step, t and mark to those it was taken with; false if none is left
+    bool restore(FlowField& flow, int& step, double& t, Tracers* tracers = nullptr, OutputMark* mark = nullptr,
+                 SolverStats* stats = nullptr);
+
+    int size() const { return count_; }
+    // Output mark of the oldest checkpoint still held: nothing before it can be undone
+    const OutputMark& oldest_mark() const { return slots_[(newest_ - count_ + 1 + depth_) % depth_].mark; }
+
+private:
+    struct Entry {
+        FlowField flow;
+        std::unique_ptr<Tracers> tracers;
+        int step = 0;
+        double t = 0.0;
+        int restores = 0;
+        OutputMark mark;
+        SolverStats stats;
+        explicit Entry(const FlowField& f) : flow(f) {}
+    };
+    std::vector<Entry> slots_;
+    int depth_, tries_;
+    int newest_ = -1, count_ = 0;
+};
@@ -7,11 +7,11 @@ if [ ! -x mhd_solver ]; then
     bash compile.sh
 fi
 
-# Run solver and capture output
-./mhd_solver | tee solver.log
+# Run solver and capture output (arguments are passed on, e.g. --config=run.cfg --nx=128)
+./mhd_solver "$@" | tee solver.log
 
-# Verify that CSV output files exist
-if ! ls Result/out_*.csv >/dev/null 2>&1; then
+# Verify that output exists (CSV files or the snapshot container)
+if ! ls Result/out_*.csv >/dev/null 2>&1 && [ ! -s Result/snapshots.mhd ]; then
     echo "No output generated in Result/" >&2
     exit 1
 fi
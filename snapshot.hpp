@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Append-only snapshot container: all output steps of a run in one file,
+// <dir>/snapshots.mhd, plus a side index <dir>/snapshots.idx mapping each
+// step to its record, so a reader finds any (step, field) with one index
+// lookup. snapshots.py reads it from Python.
+//
+// Layout (native little-endian):
+//   header  "MHDSNAP1", u32 version (2), u32 nfields, i32 nx, i32 ny,
+//           f64 x0, y0, dx, dy, nfields x char[16] names, zero-padded to 64 bytes
+//   record  "MHDSTEP2", i64 step, f64 time, u64 checksum, u64 payload bytes,
+//           u32 kind, u32 codec, then the payload: nfields x u64 blob sizes,
+//           then one blob per field, each zero-padded to 8 bytes
+//   index   "MHDSIDX1", then per record i64 step, f64 time, u64 offset
+// A field is nx*ny f64, value(i,j) at i*ny + j, at point (x0 + i*dx, y0 + j*dy).
+// The checksum is sum_k w_k*(2k+1) mod 2^64 over the payload words w_k.
+//
+// Record kinds:
+//   raw       blobs are the fields as they are (codec 0)
+//   keyframe  blobs are the fields, byte-shuffled (byte b of every value
+//             together), then deflated if codec is 1
+//   delta     as keyframe, but of the fields XORed with the previous record's
+// With keyframe_every = N, every N-th record is a keyframe and the others are
+// deltas, so a step is rebuilt from one keyframe and at most N-1 deltas.
+// Successive steps share sign, exponent and leading mantissa bits, so their
+// XOR has leading zero bytes that deflate well. Compressed records may round
+// the values to mantissa_bits (of 52) first: the low mantissa bits are noise
+// to the compressor, and 20 bits keep the 6 digits of the CSV output.
+// Compression needs zlib (-DMHD_USE_ZLIB -lz, which the build scripts add
+// when it is installed); without it keyframe_every is ignored and records
+// are written raw.
+//
+// A record is flushed before its index entry is appended. On reopen, index
+// entries past the end of the data are dropped, complete records after the
+// last indexed one are re-indexed if their checksum matches, and anything
+// after that (a torn tail from a crash) is ignored, and truncated by a writer.
+// Data is flushed to the OS, not synced, so a process crash loses at most the
+// record being written.
+
+struct SnapshotLayout {
+    int nx = 0, ny = 0;
+    double x0 = 0.0, y0 = 0.0, dx = 0.0, dy = 0.0;
+    std::vector<std::string> fields;   // at most 15 characters each
+};
+
+struct SnapshotEntry {
+    long step;
+    double time;
+    std::uint64_t offset;   // of the record header in snapshots.mhd
+};
+
+// Whether this build can write compressed (keyframe/delta) records
+bool snapshot_compression_available();
+
+class SnapshotWriter {
+public:
+    // Creates the container in dir, or appends to an existing one with the
+    // same layout; the first record appended is then a keyframe.
+    // keyframe_every = 0 writes raw records; mantissa_bits < 52 rounds the
+    // values of compressed records. Throws std::runtime_error on I/O errors
+    // or a layout mismatch.
+    SnapshotWriter(const std::string& dir, const SnapshotLayout& layout, int keyframe_every = 0,
+                   int mantissa_bits = 52);
+    ~SnapshotWriter();
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    // One nx*ny array per layout field, in layout order
+    void append(long step, double time, const std::vector<const double*>& fields);
+    // Drops the records after the first `records` from the container and its
+    // index (a rolled-back run rewriting steps); the next record is a keyframe
+    void truncate(size_t records);
+
+    const SnapshotLayout& layout() const { return layout_; }
+    const std::vector<SnapshotEntry>& entries() const { return entries_; }
+    std::uint64_t bytes_written() const { return written_; }   // record bytes appended by this writer
+
+private:
+    SnapshotLayout layout_;
+    std::vector<SnapshotEntry> entries_;
+    std::FILE* data_ = nullptr;
+    std::FILE* index_ = nullptr;
+    std::uint64_t end_ = 0;       // end of the last record
+    std::uint64_t written_ = 0;
+    int keyframe_every_ = 0;
+    int mantissa_bits_ = 52;
+    int since_key_ = -1;          // records since the last keyframe, -1: none yet
+    std::vector<std::uint64_t> prev_;   // fields of the last record (as stored), for deltas
+    std::vector<unsigned char> shuffled_, packed_;
+};
+
+class SnapshotReader {
+public:
+    // Opens <dir>/snapshots.mhd, recovering as described above. Throws
+    // std::runtime_error if the file is missing or its header is invalid.
+    explicit SnapshotReader(const std::string& dir);
+    ~SnapshotReader();
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    const SnapshotLayout& layout() const { return layout_; }
+    const std::vector<SnapshotEntry>& entries() const { return entries_; }
+    // Field `field` of record `record` (an index into entries()), nx*ny values
+    std::vector<double> read(size_t record, const std::string& field) const;
+
+private:
+    SnapshotLayout layout_;
+    std::vector<SnapshotEntry> entries_;
+    std::FILE* data_ = nullptr;
+};
@@ -0,0 +1,185 @@
+"""Read solver output: the snapshot container or the per-step CSV files.
+
+``output_format = snapshots`` (or ``both``) makes the solver write every full
+dump into ``Result/snapshots.mhd`` with a side index ``snapshots.idx``; the
+layout is documented in ``snapshot.hpp``.  ``Snapshots`` opens the
+container and reads any (step, field) from its record, or from the
+keyframe before it and the deltas in between.  Records after the
+last index entry are recovered if complete and intact, and a torn tail left
+by a crash is ignored.
+
+``open_result(dir)`` returns a ``Snapshots`` when the container exists and a
+``CsvResult`` with the same interface otherwise::
+
+    res = open_result("Result")
+    for step in res.steps:
+        rho = res.read(step, "rho")     # shape (nx, ny), rho[i, j] at (xs[i], ys[j])
+
+``read_tracers(dir)`` loads the tracer trajectories ``tracers.bin`` written
+with ``tracers > 0`` (layout in ``tracers.hpp``).
+"""
+
+import glob
+import os
+import re
+import struct
+import zlib
+
+import numpy as np
+
+_HEADER_TAG = b"MHDSNAP1"
+_RECORD_TAG = b"MHDSTEP2"
+_INDEX_TAG = b"MHDSIDX1"
+_VERSION = 2
+_NAME = 16
+_RECORD_HEADER = struct.Struct("<8sqdQQII")   # tag, step, time, checksum, payload bytes, kind, codec
+_INDEX_ENTRY = struct.Struct("<qdQ")          # step, time, offset
+_RAW, _KEYFRAME, _DELTA = 0, 1, 2
+_STORED, _DEFLATE = 0, 1
+
+
+def _checksum(payload):
+    words = np.frombuffer(payload, dtype="<u8")
+    return int(np.sum(words * (2 * np.arange(words.size, dtype=np.uint64) + 1), dtype=np.uint64))
+
+
+class Snapshots:
+    """Random access to ``<dir>/snapshots.mhd``."""
+
+    def __init__(self, result_dir="Result"):
+        self.path = os.path.join(result_dir, "snapshots.mhd")
+        self._file = open(self.path, "rb")
+        head = self._file.read(56)
+        if len(head) < 56 or head[:8] != _HEADER_TAG:
+            raise ValueError(f"{self.path}: not a snapshot container")
+        version, nfields, self.nx, self.ny, x0, y0, dx, dy = struct.unpack("<IIii4d", head[8:56])
+        if version != _VERSION:
+            raise ValueError(f"{self.path}: unsupported version {version}")
+        names = self._file.read(_NAME * nfields)
+        self.fields = [names[k*_NAME:(k+1)*_NAME].split(b"\0")[0].decode() for k in range(nfields)]
+        self.xs = x0 + dx * np.arange(self.nx)
+        self.ys = y0 + dy * np.arange(self.ny)
+
+        self._header_size = (56 + _NAME * nfields + 63) // 64 * 64
+        self._entries = self._recover(os.path.join(result_dir, "snapshots.idx"))
+        # A step written twice (a run appended to the container) reads its last record
+        self._by_step = {step: k for k, (step, _, _) in enumerate(self._entries)}
+        self.steps = sorted(self._by_step)
+        self.times = [self._entries[self._by_step[s]][1] for s in self.steps]
+
+    def _record_at(self, offset, size):
+        """(step, time, checksum, payload bytes, kind, codec) of the record at offset, if it fits"""
+        if offset + _RECORD_HEADER.size > size:
+            return None
+        self._file.seek(offset)
+        tag, *rec = _RECORD_HEADER.unpack(self._file.read(_RECORD_HEADER.size))
+        if tag != _RECORD_TAG or rec[3] % 8 or offset + _RECORD_HEADER.size + rec[3] > size:
+            return None
+        return rec
+
+    def _recover(self, index_path):
+        size = os.path.getsize(self.path)
+        entries = []
+        end = self._header_size
+        if os.path.exists(index_path):
+            with open(index_path, "rb") as idx:
+                data = idx.read()
+            if data[:8] == _INDEX_TAG:
+                for k in range((len(data) - 8) // _INDEX_ENTRY.size):
+                    step, time, offset = _INDEX_ENTRY.unpack_from(data, 8 + k * _INDEX_ENTRY.size)
+                    rec = self._record_at(offset, size)
+                    if offset != end or rec is None or rec[0] != step:
+                        break
+                    entries.append((step, time, offset))
+                    end += _RECORD_HEADER.size + rec[3]
+        # Complete records the index does not cover yet
+        while True:
+            rec = self._record_at(end, size)
+            if rec is None or _checksum(self._file.read(rec[3])) != rec[2]:
+                break
+            entries.append((rec[0], rec[1], end))
+            end += _RECORD_HEADER.size + rec[3]
+        return entries
+
+    def _blob(self, k, v):
+        """Header and stored bytes of field v in record k"""
+        offset = self._entries[k][2]
+        rec = self._record_at(offset, float("inf"))
+        sizes = np.frombuffer(self._file.read(8 * len(self.fields)), dtype="<u8")
+        skip = int(sum((int(s) + 7) // 8 * 8 for s in sizes[:v]))
+        self._file.seek(skip, os.SEEK_CUR)
+        return rec, self._file.read(int(sizes[v]))
+
+    def _decode(self, rec, blob):
+        data = zlib.decompress(blob) if rec[5] == _DEFLATE else blob
+        n = self.nx * self.ny
+        return np.frombuffer(data, dtype=np.uint8).reshape(8, n).T.copy().view("<u8").ravel()
+
+    def time(self, step):
+        return self._entries[self._by_step[step]][1]
+
+    def read(self, step, field):
+        """Field ``field`` at ``step`` as an (nx, ny) array."""
+        k, v = self._by_step[step], self.fields.index(field)
+        rec, blob = self._blob(k, v)
+        if rec[4] == _RAW:
+            return np.frombuffer(blob, dtype="<f8").reshape(self.nx, self.ny)
+        # Back to the keyframe, then forward through the deltas
+        key = k
+        while rec[4] == _DELTA:
+            key -= 1
+            rec = self._record_at(self._entries[key][2], float("inf"))
+        x = self._decode(*self._blob(key, v))
+        for r in range(key + 1, k + 1):
+            x ^= self._decode(*self._blob(r, v))
+        return x.view("<f8").reshape(self.nx, self.ny)
+
+    def close(self):
+        self._file.close()
+
+
+class CsvResult:
+    """The same interface over the ``out_<field>_<step>.csv`` files."""
+
+    def __init__(self, result_dir="Result"):
+        self.dir = result_dir
+        files = glob.glob(os.path.join(result_dir, "out_rho_*.csv"))
+        self.steps = sorted(int(re.findall(r"_rho_(\d+)\.csv", f)[0]) for f in files)
+        self.times = None
+        if files:
+            sample = np.loadtxt(files[0], delimiter=",")
+            self.xs = np.unique(sample[:, 0])
+            self.ys = np.unique(sample[:, 1])
+            self.nx, self.ny = len(self.xs), len(self.ys)
+
+    def read(self, step, field):
+        data = np.loadtxt(os.path.join(self.dir, f"out_{field}_{step}.csv"), delimiter=",")
+        return data[:, 2].reshape(self.nx, self.ny)
+
+    def close(self):
+        pass
+
+
+def open_result(result_dir="Result"):
+    if os.path.exists(os.path.join(result_dir, "snapshots.mhd")):
+        return Snapshots(result_dir)
+    return CsvResult(result_dir)
+
+
+def read_tracers(result_dir="Result"):
+    """(steps, times, x, y) from ``<dir>/tracers.bin``; x and y have shape (frames, count).
+
+    x[f, p] is particle p at steps[f]. A torn last frame is ignored.
+    """
+    path = os.path.join(result_dir, "tracers.bin")
+    with open(path, "rb") as f:
+        head = f.read(24)
+    if len(head) < 24 or head[:8] != b"MHDTRAC1":
+        raise ValueError(f"{path}: not a trajectory file")
+    version, _, count = struct.unpack("<IIQ", head[8:24])
+    if version != 1:
+        raise ValueError(f"{path}: unsupported version {version}")
+    frame = np.dtype([("step", "<i8"), ("time", "<f8"), ("x", "<f4", (count,)), ("y", "<f4", (count,))])
+    frames = (os.path.getsize(path) - 24) // frame.itemsize
+    data = np.memmap(path, dtype=frame, mode="r", offset=24, shape=(frames,))
+    return data["step"].copy(), data["time"].copy(), np.array(data["x"]), np.array(data["y"])
@@ -1,534 +1,887 @@
 // new version
 #include "solver.hpp"
-#include <omp.h>
+#include "ct.hpp"
+#include "projection.hpp"
+#include "diffusion.hpp"
+#include "riemann.hpp"
+#include "lts.hpp"
+#include "split.hpp"
+#include "activity.hpp"
+#include "exec.hpp"
 #include <cmath>
 #include <vector>
 #include <iostream>
 #include <algorithm>
 
-static constexpr double ETA = 0.001;    // Magnetic diffusivity
-static constexpr double CH = 0.8;      // GLM wave speed
-static constexpr double CR = 0.01;     // GLM damping coefficient (improved value)
-static constexpr double gamma_gas = 5.0/3.0;
-
-// Helper function: compute Laplacian
-static inline double laplacian(const Grid& g, int i, int j) {
-    return (g.data[i+1][j] - 2*g.data[i][j] + g.data[i-1][j])/(g.dx*g.dx)
-         + (g.data[i][j+1] - 2*g.data[i][j] + g.data[i][j-1])/(g.dy*g.dy);
+// Compute dynamic CFL timestep
+template <class Phys>
+static double cfl_timestep(const FlowField& flow, double cfl_number) {
+    double dt_min = 1e10;
+    const Grid& grid = flow.rho;
+    
+    auto min = [](double a, double b){ return std::min(a, b); };
+    dt_min = exec::reduce_2d(1, grid.nx-1, 1, grid.ny-1, dt_min, min, [&](int i, int j){
+        double rho = flow.rho.data[i][j];
+        double u = flow.u.data[i][j];
+        double v = flow.v.data[i][j];
+        double p = flow.p.data[i][j];
+        double Bx = flow.bx.data[i][j];
+        double By = flow.by.data[i][j];
+        double Bz = 0.0;
+#ifdef MHD_2P5D
+        Bz = flow.bz.data[i][j];
+#endif
+        
+        double cf = compute_fast_speed<Phys>(rho, p, Bx, By, Bz);
+        
+        double dt_x = grid.dx / (std::abs(u) + cf);
+        double dt_y = grid.dy / (std::abs(v) + cf);
+        
+        return std::min(dt_x, dt_y);
+    });
+    
+    double dt_glm = std::min(grid.dx, grid.dy) / Phys::ch;
+    if(dt_min > 1.0) // prevent unrealistically large dt due to NaNs
+        dt_min = std::min(grid.dx, grid.dy) / Phys::ch;
+    return cfl_number * std::min(dt_min, dt_glm);
 }
 
-// Minmod slope limiter
-static inline double minmod(double a, double b){
-    if(a*b <= 0.0) return 0.0;
-    return (std::abs(a) < std::abs(b)) ? a : b;
+// Compute divergence errors for monitoring
+std::pair<double, double> compute_divergence_errors(const FlowField& flow) {
+    const Grid& grid = flow.bx;
+    auto [max_divB, sum_divB] = stencil::abs_max_sum(1, grid.nx-1, 1, grid.ny-1, [&](int i, int j){
+        return stencil::divergence(flow.bx.data, flow.by.data, grid.dx, grid.dy, i, j);
+    });
+    return {max_divB, sum_divB / ((grid.nx-2) * (grid.ny-2))};
 }
 
-// Compute fast magnetosonic speed (for CFL condition)
-static double compute_fast_speed(double rho, double p, double Bx, double By) {
-    double cs2 = gamma_gas * p / rho;  // Sound speed squared
-    double ca2 = (Bx*Bx + By*By) / rho; // Alfven speed squared
-    return sqrt(cs2 + ca2);
+// curl_z of (ax, ay) on the interior, ghosts copied periodically
+static Grid curl_z(const Grid& ax, const Grid& ay) {
+    Grid out(ax.nx, ax.ny, ax.dx, ax.dy, ax.x0, ax.y0);
+    const int nx = ax.nx, ny = ax.ny;
+    stencil::sweep(1, nx-1, 1, ny-1, [&](int i, int j){
+        out.data[i][j] = stencil::curl_z(ax.data, ay.data, ax.dx, ax.dy, i, j);
+    });
+    for (int j = 1; j < ny-1; ++j) { out.data[0][j] = out.data[nx-2][j]; out.data[nx-1][j] = out.data[1][j]; }
+    for (int i = 0; i < nx; ++i)   { out.data[i][0] = out.data[i][ny-2]; out.data[i][ny-1] = out.data[i][1]; }
+    return out;
 }
 
-// HLL Riemann solver structure
-struct HLLFlux {
-    double F_rho, F_momx, F_momy, F_E, F_Bx, F_By, F_psi;
+Grid compute_current_density(const FlowField& flow) { return curl_z(flow.bx, flow.by); }
+Grid compute_vorticity(const FlowField& flow) { return curl_z(flow.u, flow.v); }
+
+// Face fluxes of one direction, fx[i][j] at face i+1/2 (or j+1/2), row stride dims.ny
+template <class Dims>
+struct FaceFluxes {
+    Dims dims;
+    std::vector<HLLFlux> buf;
+    explicit FaceFluxes(Dims d) : dims(d), buf((size_t)d.nx * d.ny) {}
+    HLLFlux*       operator[](int i)       { return buf.data() + (size_t)i*dims.ny; }
+    const HLLFlux* operator[](int i) const { return buf.data() + (size_t)i*dims.ny; }
 };
 
-// HLL flux computation in X direction
-HLLFlux compute_hll_flux_x(double rhoL, double uL, double vL, double pL, double BxL, double ByL, double psiL,
-                           double rhoR, double uR, double vR, double pR, double BxR, double ByR, double psiR) {
-    // Compute total pressure and energy
-    double B2L = BxL*BxL + ByL*ByL;
-    double B2R = BxR*BxR + ByR*ByR;
-    double ptL = pL + 0.5*B2L;  // Total pressure
-    double ptR = pR + 0.5*B2R;
-    double EL = pL/(gamma_gas-1) + 0.5*rhoL*(uL*uL + vL*vL) + 0.5*B2L;
-    double ER = pR/(gamma_gas-1) + 0.5*rhoR*(uR*uR + vR*vR) + 0.5*B2R;
-    
-    // Compute wave speeds
-    double cfL = compute_fast_speed(rhoL, pL, BxL, ByL);
-    double cfR = compute_fast_speed(rhoR, pR, BxR, ByR);
-    double SL = std::min(uL - cfL, uR - cfR);
-    double SR = std::max(uL + cfL, uR + cfR);
-    
-    HLLFlux flux;
-    
-    if (SL > 0) {
-        // Left state flux
-        flux.F_rho = rhoL * uL;
-        flux.F_momx = rhoL * uL * uL + ptL - BxL * BxL;
-        flux.F_momy = rhoL * uL * vL - BxL * ByL;
-        flux.F_E = (EL + ptL) * uL - BxL * (uL*BxL + vL*ByL);
-        flux.F_Bx = psiL;  // GLM
-        flux.F_By = uL * ByL - vL * BxL;
-        flux.F_psi = CH * CH * BxL;
+// Conserved state of one cell after the flux update
+struct CellUpdate {
+    double rho, mx, my, e, bx, by, psi;
+#ifdef MHD_2P5D
+    double mz, bz;
+#endif
+};
+
+// Cell (i,j) advanced with its four face fluxes plus the explicit diffusion
+// terms scaled by diffusion_weight, before any floor. Under CT the field is
+// the average of the faces, which have already been advanced.
+template <class Phys>
+static inline CellUpdate advance_cell(const FlowField& flow, int i, int j,
+                                      const HLLFlux& flux_xp, const HLLFlux& flux_xm,
+                                      const HLLFlux& flux_yp, const HLLFlux& flux_ym,
+                                      double dt, double nu, bool use_ct, bool use_glm,
+                                      bool explicit_diffusion, double diffusion_weight = 1.0) {
+    const Grid& grid = flow.rho;
+    double rho = flow.rho.data[i][j];
+    double u = flow.u.data[i][j];
+    double v = flow.v.data[i][j];
+    double Bx = flow.bx.data[i][j];
+    double By = flow.by.data[i][j];
+    double psi = flow.psi.data[i][j];
+
+    CellUpdate c;
+    c.rho = rho - dt/grid.dx * (flux_xp.F_rho - flux_xm.F_rho)
+                - dt/grid.dy * (flux_yp.F_rho - flux_ym.F_rho);
+    c.mx = rho*u - dt/grid.dx * (flux_xp.F_momx - flux_xm.F_momx)
+                 - dt/grid.dy * (flux_yp.F_momx - flux_ym.F_momx);
+    c.my = rho*v - dt/grid.dx * (flux_xp.F_momy - flux_xm.F_momy)
+                 - dt/grid.dy * (flux_yp.F_momy - flux_ym.F_momy);
+    c.e = flow.e.data[i][j] - dt/grid.dx * (flux_xp.F_E - flux_xm.F_E)
+                            - dt/grid.dy * (flux_yp.F_E - flux_ym.F_E);
+
+    c.psi = psi;
+    if (use_ct) {
+        // Faces were advanced with the corner EMFs
+        c.bx = 0.5 * (flow.bxf.data[i-1][j] + flow.bxf.data[i][j]);
+        c.by = 0.5 * (flow.byf.data[i][j-1] + flow.byf.data[i][j]);
+    } else {
+        c.bx = Bx - dt/grid.dx * (flux_xp.F_Bx - flux_xm.F_Bx)
+                  - dt/grid.dy * (flux_yp.F_Bx - flux_ym.F_Bx);
+        c.by = By - dt/grid.dx * (flux_xp.F_By - flux_xm.F_By)
+                  - dt/grid.dy * (flux_yp.F_By - flux_ym.F_By);
+        if (use_glm)
+            c.psi = psi - dt/grid.dx * (flux_xp.F_psi - flux_xm.F_psi)
+                        - dt/grid.dy * (flux_yp.F_psi - flux_ym.F_psi);
     }
-    else if (SR < 0) {
-        // Right state flux
-        flux.F_rho = rhoR * uR;
-        flux.F_momx = rhoR * uR * uR + ptR - BxR * BxR;
-        flux.F_momy = rhoR * uR * vR - BxR * ByR;
-        flux.F_E = (ER + ptR) * uR - BxR * (uR*BxR + vR*ByR);
-        flux.F_Bx = psiR;  // GLM
-        flux.F_By = uR * ByR - vR * BxR;
-        flux.F_psi = CH * CH * BxR;
+#ifdef MHD_2P5D
+    c.mz = rho*flow.w.data[i][j] - dt/grid.dx * (flux_xp.F_momz - flux_xm.F_momz)
+                                 - dt/grid.dy * (flux_yp.F_momz - flux_ym.F_momz);
+    c.bz = flow.bz.data[i][j] - dt/grid.dx * (flux_xp.F_Bz - flux_xm.F_Bz)
+                              - dt/grid.dy * (flux_yp.F_Bz - flux_ym.F_Bz);
+#endif
+
+    // Viscous terms
+    const double dtw = dt * diffusion_weight;
+    if (nu > 0 && explicit_diffusion) {
+        c.mx += dtw * nu * rho * laplacian(flow.u, i, j);
+        c.my += dtw * nu * rho * laplacian(flow.v, i, j);
+#ifdef MHD_2P5D
+        c.mz += dtw * nu * rho * laplacian(flow.w, i, j);
+#endif
     }
-    else {
-        // HLL average
-        double FL_rho = rhoL * uL;
-        double FR_rho = rhoR * uR;
-        double FL_momx = rhoL * uL * uL + ptL - BxL * BxL;
-        double FR_momx = rhoR * uR * uR + ptR - BxR * BxR;
-        double FL_momy = rhoL * uL * vL - BxL * ByL;
-        double FR_momy = rhoR * uR * vR - BxR * ByR;
-        double FL_E = (EL + ptL) * uL - BxL * (uL*BxL + vL*ByL);
-        double FR_E = (ER + ptR) * uR - BxR * (uR*BxR + vR*ByR);
-        double FL_By = uL * ByL - vL * BxL;
-        double FR_By = uR * ByR - vR * BxR;
-        
-        flux.F_rho = (SR * FL_rho - SL * FR_rho + SL * SR * (rhoR - rhoL)) / (SR - SL);
-        flux.F_momx = (SR * FL_momx - SL * FR_momx + SL * SR * (rhoR*uR - rhoL*uL)) / (SR - SL);
-        flux.F_momy = (SR * FL_momy - SL * FR_momy + SL * SR * (rhoR*vR - rhoL*vL)) / (SR - SL);
-        flux.F_E = (SR * FL_E - SL * FR_E + SL * SR * (ER - EL)) / (SR - SL);
-        flux.F_Bx = (SR * psiL - SL * psiR + SL * SR * (BxR - BxL)) / (SR - SL);
-        flux.F_By = (SR * FL_By - SL * FR_By + SL * SR * (ByR - ByL)) / (SR - SL);
-        flux.F_psi = CH * CH * (SR * BxL - SL * BxR + SL * SR * (psiR - psiL)) / (SR - SL);
+    // Magnetic diffusion (CT carries it in the corner EMF; bz is not part of CT)
+    if (Phys::eta > 0 && !use_ct && explicit_diffusion) {
+        c.bx += dtw * Phys::eta * laplacian(flow.bx, i, j);
+        c.by += dtw * Phys::eta * laplacian(flow.by, i, j);
     }
-    
-    return flux;
+#ifdef MHD_2P5D
+    if (Phys::eta > 0 && explicit_diffusion)
+        c.bz += dtw * Phys::eta * laplacian(flow.bz, i, j);
+#endif
+    return c;
 }
 
-// HLL flux computation in Y direction (similar to X direction)
-HLLFlux compute_hll_flux_y(double rhoL, double uL, double vL, double pL, double BxL, double ByL, double psiL,
-                           double rhoR, double uR, double vR, double pR, double BxR, double ByR, double psiR) {
-    double B2L = BxL*BxL + ByL*ByL;
-    double B2R = BxR*BxR + ByR*ByR;
-    double ptL = pL + 0.5*B2L;
-    double ptR = pR + 0.5*B2R;
-    double EL = pL/(gamma_gas-1) + 0.5*rhoL*(uL*uL + vL*vL) + 0.5*B2L;
-    double ER = pR/(gamma_gas-1) + 0.5*rhoR*(uR*uR + vR*vR) + 0.5*B2R;
-    
-    double cfL = compute_fast_speed(rhoL, pL, BxL, ByL);
-    double cfR = compute_fast_speed(rhoR, pR, BxR, ByR);
-    double SL = std::min(vL - cfL, vR - cfR);
-    double SR = std::max(vL + cfL, vR + cfR);
-    
-    HLLFlux flux;
-    
-    if (SL > 0) {
-        flux.F_rho = rhoL * vL;
-        flux.F_momx = rhoL * vL * uL - ByL * BxL;
-        flux.F_momy = rhoL * vL * vL + ptL - ByL * ByL;
-        flux.F_E = (EL + ptL) * vL - ByL * (uL*BxL + vL*ByL);
-        flux.F_Bx = vL * BxL - uL * ByL;
-        flux.F_By = psiL;  // GLM
-        flux.F_psi = CH * CH * ByL;
-    }
-    else if (SR < 0) {
-        flux.F_rho = rhoR * vR;
-        flux.F_momx = rhoR * vR * uR - ByR * BxR;
-        flux.F_momy = rhoR * vR * vR + ptR - ByR * ByR;
-        flux.F_E = (ER + ptR) * vR - ByR * (uR*BxR + vR*ByR);
-        flux.F_Bx = vR * BxR - uR * ByR;
-        flux.F_By = psiR;  // GLM
-        flux.F_psi = CH * CH * ByR;
-    }
-    else {
-        // HLL average (similar to X direction)
-        double FL_rho = rhoL * vL;
-        double FR_rho = rhoR * vR;
-        double FL_momx = rhoL * vL * uL - ByL * BxL;
-        double FR_momx = rhoR * vR * uR - ByR * BxR;
-        double FL_momy = rhoL * vL * vL + ptL - ByL * ByL;
-        double FR_momy = rhoR * vR * vR + ptR - ByR * ByR;
-        double FL_E = (EL + ptL) * vL - ByL * (uL*BxL + vL*ByL);
-        double FR_E = (ER + ptR) * vR - ByR * (uR*BxR + vR*ByR);
-        double FL_Bx = vL * BxL - uL * ByL;
-        double FR_Bx = vR * BxR - uR * ByR;
-        
-        flux.F_rho = (SR * FL_rho - SL * FR_rho + SL * SR * (rhoR - rhoL)) / (SR - SL);
-        flux.F_momx = (SR * FL_momx - SL * FR_momx + SL * SR * (rhoR*uR - rhoL*uL)) / (SR - SL);
-        flux.F_momy = (SR * FL_momy - SL * FR_momy + SL * SR * (rhoR*vR - rhoL*vL)) / (SR - SL);
-        flux.F_E = (SR * FL_E - SL * FR_E + SL * SR * (ER - EL)) / (SR - SL);
-        flux.F_Bx = (SR * FL_Bx - SL * FR_Bx + SL * SR * (BxR - BxL)) / (SR - SL);
-        flux.F_By = (SR * psiL - SL * psiR + SL * SR * (ByR - ByL)) / (SR - SL);
-        flux.F_psi = CH * CH * (SR * ByL - SL * ByR + SL * SR * (psiR - psiL)) / (SR - SL);
-    }
-    
-    return flux;
+// Smallest density and pressure the positivity limiter accepts
+static constexpr double kPositivityFloor = 1e-10;
+
+// Kinetic plus magnetic energy of a cell, plus the pressure floor
+template <class Phys>
+static inline double cell_energy_floor(const CellUpdate& c) {
+    double m2 = c.mx*c.mx + c.my*c.my;
+    double B2 = c.bx*c.bx + c.by*c.by;
+#ifdef MHD_2P5D
+    m2 += c.mz*c.mz;
+    B2 += c.bz*c.bz;
+#endif
+    return 0.5*m2/c.rho + 0.5*B2 + kPositivityFloor/(Phys::gamma - 1.0);
 }
 
-// Compute dynamic CFL timestep
-double compute_cfl_timestep(const FlowField& flow, double cfl_number) {
-    double dt_min = 1e10;
+template <class Phys>
+static inline bool is_admissible(const CellUpdate& c) {
+    return c.rho >= kPositivityFloor && c.e >= cell_energy_floor<Phys>(c);
+}
+
+// First-order HLL fluxes from the cell averages either side of a face. Under
+// CT (bxf_n/byf_n non-null) the normal field is the start-of-step face value,
+// as in the MUSCL flux.
+template <class Phys>
+static HLLFlux first_order_flux_x(const FlowField& f, const Array2D* bxf_n, int i, int j) {
+    const int a = i, b = i+1;
+    const double BxL = bxf_n ? (*bxf_n)[i][j] : f.bx.data[a][j];
+    const double BxR = bxf_n ? (*bxf_n)[i][j] : f.bx.data[b][j];
+    return compute_hll_flux_x<Phys>(
+        f.rho.data[a][j], f.u.data[a][j], f.v.data[a][j], f.p.data[a][j], BxL, f.by.data[a][j], f.psi.data[a][j],
+        f.rho.data[b][j], f.u.data[b][j], f.v.data[b][j], f.p.data[b][j], BxR, f.by.data[b][j], f.psi.data[b][j]
+#ifdef MHD_2P5D
+        , f.w.data[a][j], f.bz.data[a][j], f.w.data[b][j], f.bz.data[b][j]
+#endif
+        );
+}
+
+template <class Phys>
+static HLLFlux first_order_flux_y(const FlowField& f, const Array2D* byf_n, int i, int j) {
+    const int a = j, b = j+1;
+    const double ByL = byf_n ? (*byf_n)[i][j] : f.by.data[i][a];
+    const double ByR = byf_n ? (*byf_n)[i][j] : f.by.data[i][b];
+    return compute_hll_flux_y<Phys>(
+        f.rho.data[i][a], f.u.data[i][a], f.v.data[i][a], f.p.data[i][a], f.bx.data[i][a], ByL, f.psi.data[i][a],
+        f.rho.data[i][b], f.u.data[i][b], f.v.data[i][b], f.p.data[i][b], f.bx.data[i][b], ByR, f.psi.data[i][b]
+#ifdef MHD_2P5D
+        , f.w.data[i][a], f.bz.data[i][a], f.w.data[i][b], f.bz.data[i][b]
+#endif
+        );
+}
+
+// lo + theta*(hi - lo). Under CT the induction fluxes stay at hi: the faces
+// have already been advanced with the EMFs built from them.
+static inline HLLFlux blend_flux(const HLLFlux& lo, const HLLFlux& hi, double theta, bool use_ct) {
+    auto mix = [theta](double l, double h){ return l + theta*(h - l); };
+    HLLFlux f;
+    f.F_rho  = mix(lo.F_rho,  hi.F_rho);
+    f.F_momx = mix(lo.F_momx, hi.F_momx);
+    f.F_momy = mix(lo.F_momy, hi.F_momy);
+    f.F_E    = mix(lo.F_E,    hi.F_E);
+    f.F_Bx   = use_ct ? hi.F_Bx : mix(lo.F_Bx, hi.F_Bx);
+    f.F_By   = use_ct ? hi.F_By : mix(lo.F_By, hi.F_By);
+    f.F_psi  = mix(lo.F_psi,  hi.F_psi);
+#ifdef MHD_2P5D
+    f.F_momz = mix(lo.F_momz, hi.F_momz);
+    f.F_Bz   = mix(lo.F_Bz,   hi.F_Bz);
+#endif
+    return f;
+}
+
+struct PositivityResult {
+    std::vector<std::pair<int,int>> cells;  // interior cells whose faces changed
+    std::vector<double> diffusion;           // per-cell weight of the explicit diffusion terms
+    long faces = 0;                          // faces blended towards first order
+};
+
+// Positivity-preserving flux limiter (SolverOptions::positivity). The low-order
+// update of a cell is first-order HLL fluxes on its four faces and no explicit
+// diffusion. Each cell in `bad` gets the largest theta in [0,1], found by
+// bisection, for which the blend F_low + theta*(F_muscl - F_low) on its faces,
+// plus theta times its diffusion terms, leaves it admissible (rho and
+// p >= kPositivityFloor). A face takes the smaller theta of its two cells.
+// Cells that a neighbour's blending pushes out of the admissible set fall back
+// to the low-order update, repeated until no more cells do, so the floor in
+// update_level only catches cells whose first-order update is inadmissible.
+// Each face keeps a single flux, so the update stays conservative. The
+// periodic twin of a boundary face (fx[0] and fx[nx-2], fy[.][0] and
+// fy[.][ny-2]) is limited with it. The GLM psi flux is part of the blended
+// fluxes; its damping source changes psi only, which admissibility does not
+// depend on.
+template <class Phys, class Faces, class Advance>
+static PositivityResult limit_positivity(const FlowField& flow, Faces& fx, Faces& fy,
+                                         const std::vector<std::pair<int,int>>& bad,
+                                         const Advance& advance,
+                                         const Array2D* bxf_n, const Array2D* byf_n) {
     const Grid& grid = flow.rho;
-    
-    #pragma omp parallel for collapse(2) reduction(min:dt_min)
-    for (int i = 1; i < grid.nx-1; ++i) {
-        for (int j = 1; j < grid.ny-1; ++j) {
-            double rho = flow.rho.data[i][j];
-            double u = flow.u.data[i][j];
-            double v = flow.v.data[i][j];
-            double p = flow.p.data[i][j];
-            double Bx = flow.bx.data[i][j];
-            double By = flow.by.data[i][j];
-            
-            double cf = compute_fast_speed(rho, p, Bx, By);
-            
-            double dt_x = grid.dx / (std::abs(u) + cf);
-            double dt_y = grid.dy / (std::abs(v) + cf);
-            
-            dt_min = std::min(dt_min, std::min(dt_x, dt_y));
+    const int nx = grid.nx, ny = grid.ny;
+    const bool use_ct = bxf_n != nullptr;
+    const int bisection_steps = 20;
+    const Faces fx_hi = fx, fy_hi = fy;
+
+    // Face limiting factors and cell diffusion weights, 1 = untouched
+    PositivityResult res;
+    std::vector<double> thx((size_t)nx*ny, 1.0), thy((size_t)nx*ny, 1.0);
+    res.diffusion.assign((size_t)nx*ny, 1.0);
+    auto limit_x = [&](int i, int j, double th){
+        double& t = thx[(size_t)i*ny + j];
+        t = std::min(t, th);
+        if (i == 0)    thx[(size_t)(nx-2)*ny + j] = t;
+        if (i == nx-2) thx[(size_t)j] = t;
+    };
+    auto limit_y = [&](int i, int j, double th){
+        double& t = thy[(size_t)i*ny + j];
+        t = std::min(t, th);
+        if (j == 0)    thy[(size_t)i*ny + ny-2] = t;
+        if (j == ny-2) thy[(size_t)i*ny] = t;
+    };
+    auto limit_cell = [&](int i, int j, double th){
+        limit_x(i, j, th); limit_x(i-1, j, th);
+        limit_y(i, j, th); limit_y(i, j-1, th);
+        double& w = res.diffusion[(size_t)i*ny + j];
+        w = std::min(w, th);
+    };
+
+    std::vector<double> theta(bad.size());
+    exec::for_each(0, (long)bad.size(), [&](long b){
+        auto [i, j] = bad[b];
+        const HLLFlux lo[4] = {first_order_flux_x<Phys>(flow, bxf_n, i, j), first_order_flux_x<Phys>(flow, bxf_n, i-1, j),
+                               first_order_flux_y<Phys>(flow, byf_n, i, j), first_order_flux_y<Phys>(flow, byf_n, i, j-1)};
+        const HLLFlux hi[4] = {fx[i][j], fx[i-1][j], fy[i][j], fy[i][j-1]};
+        auto admissible = [&](double th){
+            HLLFlux f[4];
+            for (int k = 0; k < 4; ++k) f[k] = blend_flux(lo[k], hi[k], th, use_ct);
+            return is_admissible<Phys>(advance(i, j, f[0], f[1], f[2], f[3], th));
+        };
+        double a = 0.0, c = 1.0;
+        if (!admissible(0.0)) c = 0.0;
+        for (int it = 0; it < bisection_steps && c > 0.0; ++it) {
+            double m = 0.5*(a + c);
+            (admissible(m) ? a : c) = m;
         }
-    }
-    
-    double dt_glm = std::min(grid.dx, grid.dy) / CH;
-    if(dt_min > 1.0) // prevent unrealistically large dt due to NaNs
-        dt_min = std::min(grid.dx, grid.dy) / CH;
-    return cfl_number * std::min(dt_min, dt_glm);
-}
+        theta[b] = a;
+    });
+    for (size_t b = 0; b < bad.size(); ++b)
+        limit_cell(bad[b].first, bad[b].second, theta[b]);
 
-// Compute divergence errors for monitoring
-std::pair<double, double> compute_divergence_errors(const FlowField& flow) {
-    const Grid& grid = flow.bx;
-    double max_divB = 0.0;
-    double L1_divB = 0.0;
-    int count = 0;
-    
-    #pragma omp parallel for collapse(2) reduction(max:max_divB) reduction(+:L1_divB,count)
-    for (int i = 1; i < grid.nx-1; ++i) {
-        for (int j = 1; j < grid.ny-1; ++j) {
-            double divB = (flow.bx.data[i+1][j] - flow.bx.data[i-1][j]) / (2*grid.dx)
-                        + (flow.by.data[i][j+1] - flow.by.data[i][j-1]) / (2*grid.dy);
-            
-            double abs_divB = std::abs(divB);
-            max_divB = std::max(max_divB, abs_divB);
-            L1_divB += abs_divB;
-            count++;
+    // Apply the face factors; collect the interior cells next to changed faces
+    std::vector<char> touched((size_t)nx*ny, 0);
+    auto touch = [&](int i, int j){
+        if (i < 1 || i > nx-2 || j < 1 || j > ny-2) return;
+        char& t = touched[(size_t)i*ny + j];
+        if (!t) { t = 1; res.cells.emplace_back(i, j); }
+    };
+    auto apply = [&](){
+        for (int i = 0; i < nx-1; ++i)
+            for (int j = 0; j < ny-1; ++j) {
+                double tx = thx[(size_t)i*ny + j], ty = thy[(size_t)i*ny + j];
+                if (tx < 1.0 && j >= 1) {
+                    fx[i][j] = blend_flux(first_order_flux_x<Phys>(flow, bxf_n, i, j), fx_hi[i][j], tx, use_ct);
+                    touch(i, j); touch(i+1, j);
+                }
+                if (ty < 1.0 && i >= 1) {
+                    fy[i][j] = blend_flux(first_order_flux_y<Phys>(flow, byf_n, i, j), fy_hi[i][j], ty, use_ct);
+                    touch(i, j); touch(i, j+1);
+                }
+            }
+    };
+    apply();
+
+    // Cells pushed out of the admissible set by a neighbour's limiting go
+    // first order; that limits their other faces, so repeat until none do.
+    // Every round moves at least one more cell to the low-order update.
+    for (bool fallback = true; fallback; ) {
+        fallback = false;
+        for (size_t k = 0; k < res.cells.size(); ++k) {
+            auto [i, j] = res.cells[k];
+            const double w = res.diffusion[(size_t)i*ny + j];
+            if (w > 0.0 && !is_admissible<Phys>(advance(i, j, fx[i][j], fx[i-1][j], fy[i][j], fy[i][j-1], w))) {
+                limit_cell(i, j, 0.0);
+                fallback = true;
+            }
         }
+        if (fallback) apply();
     }
-    
-    L1_divB /= count;
-    return {max_divB, L1_divB};
+
+    // Count each periodic face pair once
+    for (int i = 0; i < nx-2; ++i)
+        for (int j = 1; j < ny-1; ++j) res.faces += thx[(size_t)i*ny + j] < 1.0;
+    for (int i = 1; i < nx-1; ++i)
+        for (int j = 0; j < ny-2; ++j) res.faces += thy[(size_t)i*ny + j] < 1.0;
+    return res;
 }
 
 // Main improved MHD solver function
 
-static void update_level(FlowField& flow,double dt,double nu){
+// Faces [j0, j1) of one row for riemann = rusanov or hybrid. The row is cut
+// into runs of consecutive needed faces of one kind, and each run goes through
+// its kernel as one loop, so the branch-free Rusanov kernel runs over
+// contiguous faces instead of alternating with HLL face by face. Returns the
+// Rusanov and HLL face counts.
+template <class Phys, class Needed, class Sharp, class Face>
+static std::pair<long, long> route_faces(int j0, int j1, bool hybrid, Needed needed, Sharp sharp, Face face) {
+    long counts[2] = {0, 0};
+    for (int j = j0; j < j1; ) {
+        if (!needed(j)) { ++j; continue; }
+        const bool hll = hybrid && sharp(j);
+        int e = j + 1;
+        while (e < j1 && needed(e) && (hybrid && sharp(e)) == hll) ++e;
+        if (hll) {
+            for (int k = j; k < e; ++k) face(HLLSolver<Phys>{}, k);
+        } else {
+            #pragma omp simd
+            for (int k = j; k < e; ++k) face(RusanovSolver<Phys>{}, k);
+        }
+        counts[hll] += e - j;
+        j = e;
+    }
+    return {counts[0], counts[1]};
+}
+
+template <class Phys, class Dims>
+static double update_level(FlowField& flow,double dt,double nu,const SolverOptions& opts,Dims dims){
     Grid& grid = flow.rho;
+    const int nx = dims.nx, ny = dims.ny;   // compile-time constants for FixedDims
     
     // Use dynamic CFL timestep
-    double dt_cfl = compute_cfl_timestep(flow);
+    double dt_cfl = cfl_timestep<Phys>(flow, opts.cfl);
     dt = std::min(dt, dt_cfl);
     
     // Temporary arrays
     auto rho_new = flow.rho.data;
-    auto momx_new = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-    auto momy_new = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
+    Array2D momx_new(nx, ny), momy_new(nx, ny);
     auto e_new = flow.e.data;
     auto bx_new = flow.bx.data;
     auto by_new = flow.by.data;
     auto psi_new = flow.psi.data;
 
-    // Pre-compute limited slopes for MUSCL reconstruction
-    auto srho_x = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-    auto su_x   = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-    auto sv_x   = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-    auto sp_x   = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-    auto sbx_x  = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-    auto sby_x  = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-    auto spsi_x = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-
-    auto srho_y = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-    auto su_y   = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-    auto sv_y   = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-    auto sp_y   = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-    auto sbx_y  = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-    auto sby_y  = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-    auto spsi_y = std::vector<std::vector<double>>(grid.nx, std::vector<double>(grid.ny));
-
-    auto zero_slopes = [](auto& arr){
-        for(auto& r : arr) std::fill(r.begin(), r.end(), 0.0);
+    // Pre-compute limited slopes for MUSCL reconstruction; cells without both
+    // neighbours along an axis keep a zero slope
+    auto slopes = [&]{ return Array2D(nx, ny); };
+    Array2D srho_x = slopes(), su_x = slopes(), sv_x = slopes(), sp_x = slopes();
+    Array2D sbx_x = slopes(), sby_x = slopes(), spsi_x = slopes();
+    Array2D srho_y = slopes(), su_y = slopes(), sv_y = slopes(), sp_y = slopes();
+    Array2D sbx_y = slopes(), sby_y = slopes(), spsi_y = slopes();
+#ifdef MHD_2P5D
+    Array2D momz_new(nx, ny);
+    auto bz_new = flow.bz.data;
+    Array2D sw_x = slopes(), sbz_x = slopes(), sw_y = slopes(), sbz_y = slopes();
+#endif
+
+    // Tiles that have barely changed keep last step's fluxes (activity.hpp)
+    ActivityMask* mask = (opts.activity && opts.activity_tol > 0.0) ? opts.activity : nullptr;
+    if (mask) mask->begin(flow, opts.activity_tile, opts.activity_tol);
+
+    struct SlopeField { const Grid* g; Array2D* sx; Array2D* sy; };
+    const SlopeField slope_fields[] = {
+        {&flow.rho, &srho_x, &srho_y}, {&flow.u, &su_x, &su_y}, {&flow.v, &sv_x, &sv_y},
+        {&flow.p, &sp_x, &sp_y}, {&flow.bx, &sbx_x, &sbx_y}, {&flow.by, &sby_x, &sby_y},
+        {&flow.psi, &spsi_x, &spsi_y},
+#ifdef MHD_2P5D
+        {&flow.w, &sw_x, &sw_y}, {&flow.bz, &sbz_x, &sbz_y},
+#endif
     };
-    zero_slopes(srho_x);  zero_slopes(su_x);  zero_slopes(sv_x);
-    zero_slopes(sp_x);    zero_slopes(sbx_x); zero_slopes(sby_x); zero_slopes(spsi_x);
-    zero_slopes(srho_y);  zero_slopes(su_y);  zero_slopes(sv_y);
-    zero_slopes(sp_y);    zero_slopes(sbx_y); zero_slopes(sby_y); zero_slopes(spsi_y);
-
-    // Slopes in X direction
-    #pragma omp parallel for collapse(2)
-    for(int i=1;i<grid.nx-1;++i){
-        for(int j=0;j<grid.ny;++j){
-            srho_x[i][j] = minmod(flow.rho.data[i][j]-flow.rho.data[i-1][j],
-                                  flow.rho.data[i+1][j]-flow.rho.data[i][j]);
-            su_x[i][j]   = minmod(flow.u.data[i][j]-flow.u.data[i-1][j],
-                                  flow.u.data[i+1][j]-flow.u.data[i][j]);
-            sv_x[i][j]   = minmod(flow.v.data[i][j]-flow.v.data[i-1][j],
-                                  flow.v.data[i+1][j]-flow.v.data[i][j]);
-            sp_x[i][j]   = minmod(flow.p.data[i][j]-flow.p.data[i-1][j],
-                                  flow.p.data[i+1][j]-flow.p.data[i][j]);
-            sbx_x[i][j]  = minmod(flow.bx.data[i][j]-flow.bx.data[i-1][j],
-                                  flow.bx.data[i+1][j]-flow.bx.data[i][j]);
-            sby_x[i][j]  = minmod(flow.by.data[i][j]-flow.by.data[i-1][j],
-                                  flow.by.data[i+1][j]-flow.by.data[i][j]);
-            spsi_x[i][j] = minmod(flow.psi.data[i][j]-flow.psi.data[i-1][j],
-                                  flow.psi.data[i+1][j]-flow.psi.data[i][j]);
+    using stencil::limited_slopes;
+    using stencil::limited_slope;
+    using stencil::X;
+    using stencil::Y;
+    if (!mask) {
+        for (const SlopeField& f : slope_fields) {
+            limited_slopes<X>(*f.g, *f.sx, nx, ny);
+            limited_slopes<Y>(*f.g, *f.sy, nx, ny);
         }
+    } else {
+        // Only the tiles next to an active tile feed fresh fluxes
+        exec::for_2d<exec::Schedule::Dynamic>(0, mask->tiles_x(), 0, mask->tiles_y(), [&](int ti, int tj){
+            if (!mask->needed(ti, tj)) return;
+            auto [i0, i1] = mask->span_x(ti);
+            auto [j0, j1] = mask->span_y(tj);
+            for (const SlopeField& f : slope_fields) {
+                for (int i = std::max(i0, 1); i < std::min(i1, nx-1); ++i) {
+                    #pragma omp simd
+                    for (int j = j0; j < j1; ++j) (*f.sx)[i][j] = limited_slope<X>(f.g->data, i, j);
+                }
+                for (int i = i0; i < i1; ++i) {
+                    #pragma omp simd
+                    for (int j = std::max(j0, 1); j < std::min(j1, ny-1); ++j)
+                        (*f.sy)[i][j] = limited_slope<Y>(f.g->data, i, j);
+                }
+            }
+        });
+    }
+
+    // Face fluxes, each computed once: fx[i][j] at x-face i+1/2, fy[i][j] at y-face j+1/2.
+    // With CT the normal field at a face is the staggered value (no jump, psi = 0).
+    const bool use_ct = (opts.divb == DivBScheme::CT);
+    const bool use_glm = (opts.divb == DivBScheme::GLM);
+    const bool explicit_diffusion = (opts.diffusion == DiffusionScheme::Explicit);
+    FaceFluxes<Dims> fx(dims), fy(dims);
+    if (mask) {
+        fx.buf.swap(mask->fx);
+        fy.buf.swap(mask->fy);
     }
 
-    // Slopes in Y direction
-    #pragma omp parallel for collapse(2)
-    for(int i=0;i<grid.nx;++i){
-        for(int j=1;j<grid.ny-1;++j){
-            srho_y[i][j] = minmod(flow.rho.data[i][j]-flow.rho.data[i][j-1],
-                                  flow.rho.data[i][j+1]-flow.rho.data[i][j]);
-            su_y[i][j]   = minmod(flow.u.data[i][j]-flow.u.data[i][j-1],
-                                  flow.u.data[i][j+1]-flow.u.data[i][j]);
-            sv_y[i][j]   = minmod(flow.v.data[i][j]-flow.v.data[i][j-1],
-                                  flow.v.data[i][j+1]-flow.v.data[i][j]);
-            sp_y[i][j]   = minmod(flow.p.data[i][j]-flow.p.data[i][j-1],
-                                  flow.p.data[i][j+1]-flow.p.data[i][j]);
-            sbx_y[i][j]  = minmod(flow.bx.data[i][j]-flow.bx.data[i][j-1],
-                                  flow.bx.data[i][j+1]-flow.bx.data[i][j]);
-            sby_y[i][j]  = minmod(flow.by.data[i][j]-flow.by.data[i][j-1],
-                                  flow.by.data[i][j+1]-flow.by.data[i][j]);
-            spsi_y[i][j] = minmod(flow.psi.data[i][j]-flow.psi.data[i][j-1],
-                                  flow.psi.data[i][j+1]-flow.psi.data[i][j]);
+    // Face kernels, generic over the solver type (HLLSolver or RusanovSolver)
+    auto face_x = [&](auto solver, int i, int j){
+        double BxL = flow.bx.data[i][j]   + 0.5*sbx_x[i][j];
+        double BxR = flow.bx.data[i+1][j] - 0.5*sbx_x[i+1][j];
+        if (use_ct) BxL = BxR = flow.bxf.data[i][j];
+        fx[i][j] = solver.x(
+            // left state at i+1/2
+            flow.rho.data[i][j] + 0.5*srho_x[i][j],
+            flow.u.data[i][j]   + 0.5*su_x[i][j],
+            flow.v.data[i][j]   + 0.5*sv_x[i][j],
+            flow.p.data[i][j]   + 0.5*sp_x[i][j],
+            BxL,
+            flow.by.data[i][j]  + 0.5*sby_x[i][j],
+            flow.psi.data[i][j] + 0.5*spsi_x[i][j],
+            // right state at i+1/2
+            flow.rho.data[i+1][j] - 0.5*srho_x[i+1][j],
+            flow.u.data[i+1][j]   - 0.5*su_x[i+1][j],
+            flow.v.data[i+1][j]   - 0.5*sv_x[i+1][j],
+            flow.p.data[i+1][j]   - 0.5*sp_x[i+1][j],
+            BxR,
+            flow.by.data[i+1][j]  - 0.5*sby_x[i+1][j],
+            flow.psi.data[i+1][j] - 0.5*spsi_x[i+1][j]
+#ifdef MHD_2P5D
+            // out-of-plane left and right states
+            , flow.w.data[i][j]    + 0.5*sw_x[i][j],
+            flow.bz.data[i][j]     + 0.5*sbz_x[i][j],
+            flow.w.data[i+1][j]    - 0.5*sw_x[i+1][j],
+            flow.bz.data[i+1][j]   - 0.5*sbz_x[i+1][j]
+#endif
+        );
+    };
+
+    auto face_y = [&](auto solver, int i, int j){
+        double ByL = flow.by.data[i][j]   + 0.5*sby_y[i][j];
+        double ByR = flow.by.data[i][j+1] - 0.5*sby_y[i][j+1];
+        if (use_ct) ByL = ByR = flow.byf.data[i][j];
+        fy[i][j] = solver.y(
+            // bottom state at j+1/2
+            flow.rho.data[i][j] + 0.5*srho_y[i][j],
+            flow.u.data[i][j]   + 0.5*su_y[i][j],
+            flow.v.data[i][j]   + 0.5*sv_y[i][j],
+            flow.p.data[i][j]   + 0.5*sp_y[i][j],
+            flow.bx.data[i][j]  + 0.5*sbx_y[i][j],
+            ByL,
+            flow.psi.data[i][j] + 0.5*spsi_y[i][j],
+            // top state at j+1/2
+            flow.rho.data[i][j+1] - 0.5*srho_y[i][j+1],
+            flow.u.data[i][j+1]   - 0.5*su_y[i][j+1],
+            flow.v.data[i][j+1]   - 0.5*sv_y[i][j+1],
+            flow.p.data[i][j+1]   - 0.5*sp_y[i][j+1],
+            flow.bx.data[i][j+1]  - 0.5*sbx_y[i][j+1],
+            ByR,
+            flow.psi.data[i][j+1] - 0.5*spsi_y[i][j+1]
+#ifdef MHD_2P5D
+            // out-of-plane bottom and top states
+            , flow.w.data[i][j]    + 0.5*sw_y[i][j],
+            flow.bz.data[i][j]     + 0.5*sbz_y[i][j],
+            flow.w.data[i][j+1]    - 0.5*sw_y[i][j+1],
+            flow.bz.data[i][j+1]   - 0.5*sbz_y[i][j+1]
+#endif
+        );
+    };
+
+    if (opts.riemann == RiemannSolver::HLL) {
+        exec::for_2d(0, nx-1, 1, ny-1, [&](int i, int j){
+            if (!mask || mask->face_x(i, j)) face_x(HLLSolver<Phys>{}, i, j);
+        });
+        exec::for_2d(1, nx-1, 0, ny-1, [&](int i, int j){
+            if (!mask || mask->face_y(i, j)) face_y(HLLSolver<Phys>{}, i, j);
+        });
+    } else {
+        // Rusanov everywhere, or with the hybrid HLL on the faces where the
+        // jump indicator exceeds riemann_threshold, either between the two
+        // cells of the face or between the next cells out, so the faces next
+        // to a jump are caught as well
+        const bool hybrid = (opts.riemann == RiemannSolver::Hybrid);
+        const double threshold = opts.riemann_threshold;
+        auto jump = [&](int ia, int ja, int ib, int jb){
+            auto B2 = [&](int i, int j){
+                double b2 = flow.bx.data[i][j]*flow.bx.data[i][j] + flow.by.data[i][j]*flow.by.data[i][j];
+#ifdef MHD_2P5D
+                b2 += flow.bz.data[i][j]*flow.bz.data[i][j];
+#endif
+                return b2;
+            };
+            return jump_indicator(flow.p.data[ia][ja], B2(ia, ja), flow.p.data[ib][jb], B2(ib, jb));
+        };
+        using Counts = std::pair<long, long>;   // Rusanov, HLL faces
+        auto add_counts = [](Counts a, Counts b){ return Counts{a.first + b.first, a.second + b.second}; };
+        // One row per call: the column range is a single dummy column
+        Counts x_faces = exec::reduce_2d(0, nx-1, 0, 1, Counts{0, 0}, add_counts, [&](int i, int){
+            const int im = std::max(i-1, 0), ip2 = std::min(i+2, nx-1);
+            return route_faces<Phys>(1, ny-1, hybrid,
+                [&](int j){ return !mask || mask->face_x(i, j); },
+                [&](int j){ return std::max(jump(i, j, i+1, j), jump(im, j, ip2, j)) > threshold; },
+                [&](auto solver, int j){ face_x(solver, i, j); });
+        });
+        Counts y_faces = exec::reduce_2d(1, nx-1, 0, 1, Counts{0, 0}, add_counts, [&](int i, int){
+            return route_faces<Phys>(0, ny-1, hybrid,
+                [&](int j){ return !mask || mask->face_y(i, j); },
+                [&](int j){
+                    return std::max(jump(i, j, i, j+1), jump(i, std::max(j-1, 0), i, std::min(j+2, ny-1))) > threshold;
+                },
+                [&](auto solver, int j){ face_y(solver, i, j); });
+        });
+        if (opts.stats) {
+            opts.stats->rusanov_faces += x_faces.first + y_faces.first;
+            opts.stats->hll_faces += x_faces.second + y_faces.second;
         }
     }
-    
-    // First compute momentum (for HLL solver)
-    #pragma omp parallel for collapse(2)
-    for (int i = 0; i < grid.nx; ++i) {
-        for (int j = 0; j < grid.ny; ++j) {
-            momx_new[i][j] = flow.rho.data[i][j] * flow.u.data[i][j];
-            momy_new[i][j] = flow.rho.data[i][j] * flow.v.data[i][j];
+
+
+    Array2D bxf_n, byf_n;
+    if (use_ct) {
+        // Corner EMF Ez = v*Bx - u*By + ETA*Jz at (i+1/2, j+1/2), arithmetic average
+        // of the four neighbouring face fluxes (F_By on x-faces is -Ez, F_Bx on y-faces is Ez)
+        Grid ez(nx, ny, grid.dx, grid.dy, grid.x0, grid.y0);
+        exec::for_2d(1, nx-1, 1, ny-1, [&](int i, int j){
+            int ip = (i+1 == nx-1) ? 1 : i+1;
+            int jp = (j+1 == ny-1) ? 1 : j+1;
+            double Jz = (flow.byf.data[i+1][j] - flow.byf.data[i][j]) / grid.dx
+                      - (flow.bxf.data[i][j+1] - flow.bxf.data[i][j]) / grid.dy;
+            ez.data[i][j] = 0.25 * (-fx[i][j].F_By - fx[i][jp].F_By
+                                    + fy[i][j].F_Bx + fy[ip][j].F_Bx)
+                          + Phys::eta * Jz;
+        });
+        for (int j = 1; j < ny-1; ++j) ez.data[0][j] = ez.data[nx-2][j];
+        for (int i = 0; i < nx-1; ++i) ez.data[i][0] = ez.data[i][ny-2];
+
+        if (opts.positivity) {
+            // The limiter's first-order fluxes use the start-of-step faces
+            bxf_n = flow.bxf.data;
+            byf_n = flow.byf.data;
         }
+        ct_update_faces(flow, ez, dt);
     }
-    
-    // Update using HLL solver
-    #pragma omp parallel for collapse(2)
-    for (int i = 1; i < grid.nx-1; ++i) {
-        for (int j = 1; j < grid.ny-1; ++j) {
-            // Get current state
-            double rho = flow.rho.data[i][j];
-            double u = flow.u.data[i][j];
-            double v = flow.v.data[i][j];
-            double p = flow.p.data[i][j];
-            double Bx = flow.bx.data[i][j];
-            double By = flow.by.data[i][j];
-            double psi = flow.psi.data[i][j];
-            
-            // X direction fluxes with MUSCL reconstruction
-            HLLFlux flux_xp = compute_hll_flux_x(
-               // left state at i+1/2
-                rho + 0.5*srho_x[i][j],
-                u   + 0.5*su_x[i][j],
-                v   + 0.5*sv_x[i][j],
-                p   + 0.5*sp_x[i][j],
-                Bx  + 0.5*sbx_x[i][j],
-                By  + 0.5*sby_x[i][j],
-                psi + 0.5*spsi_x[i][j],
-                // right state at i+1/2
-                flow.rho.data[i+1][j] - 0.5*srho_x[i+1][j],
-                flow.u.data[i+1][j]   - 0.5*su_x[i+1][j],
-                flow.v.data[i+1][j]   - 0.5*sv_x[i+1][j],
-                flow.p.data[i+1][j]   - 0.5*sp_x[i+1][j],
-                flow.bx.data[i+1][j]  - 0.5*sbx_x[i+1][j],
-                flow.by.data[i+1][j]  - 0.5*sby_x[i+1][j],
-                flow.psi.data[i+1][j] - 0.5*spsi_x[i+1][j]
-            );
-            
-            HLLFlux flux_xm = compute_hll_flux_x(
-                // left state at i-1/2
-                flow.rho.data[i-1][j] + 0.5*srho_x[i-1][j],
-                flow.u.data[i-1][j]   + 0.5*su_x[i-1][j],
-                flow.v.data[i-1][j]   + 0.5*sv_x[i-1][j],
-                flow.p.data[i-1][j]   + 0.5*sp_x[i-1][j],
-                flow.bx.data[i-1][j]  + 0.5*sbx_x[i-1][j],
-                flow.by.data[i-1][j]  + 0.5*sby_x[i-1][j],
-                flow.psi.data[i-1][j] + 0.5*spsi_x[i-1][j],
-                // right state at i-1/2
-                rho - 0.5*srho_x[i][j],
-                u   - 0.5*su_x[i][j],
-                v   - 0.5*sv_x[i][j],
-                p   - 0.5*sp_x[i][j],
-                Bx  - 0.5*sbx_x[i][j],
-                By  - 0.5*sby_x[i][j],
-                psi - 0.5*spsi_x[i][j]
-            );
-            
-            // Y direction fluxes with MUSCL reconstruction
-            HLLFlux flux_yp = compute_hll_flux_y(
-                // bottom state at j+1/2
-                rho + 0.5*srho_y[i][j],
-                u   + 0.5*su_y[i][j],
-                v   + 0.5*sv_y[i][j],
-                p   + 0.5*sp_y[i][j],
-                Bx  + 0.5*sbx_y[i][j],
-                By  + 0.5*sby_y[i][j],
-                psi + 0.5*spsi_y[i][j],
-                // top state at j+1/2
-                flow.rho.data[i][j+1] - 0.5*srho_y[i][j+1],
-                flow.u.data[i][j+1]   - 0.5*su_y[i][j+1],
-                flow.v.data[i][j+1]   - 0.5*sv_y[i][j+1],
-                flow.p.data[i][j+1]   - 0.5*sp_y[i][j+1],
-                flow.bx.data[i][j+1]  - 0.5*sbx_y[i][j+1],
-                flow.by.data[i][j+1]  - 0.5*sby_y[i][j+1],
-                flow.psi.data[i][j+1] - 0.5*spsi_y[i][j+1]
-            );
-            
-            HLLFlux flux_ym = compute_hll_flux_y(
-                // bottom state at j-1/2
-                flow.rho.data[i][j-1] + 0.5*srho_y[i][j-1],
-                flow.u.data[i][j-1]   + 0.5*su_y[i][j-1],
-                flow.v.data[i][j-1]   + 0.5*sv_y[i][j-1],
-                flow.p.data[i][j-1]   + 0.5*sp_y[i][j-1],
-                flow.bx.data[i][j-1]  + 0.5*sbx_y[i][j-1],
-                flow.by.data[i][j-1]  + 0.5*sby_y[i][j-1],
-                flow.psi.data[i][j-1] + 0.5*spsi_y[i][j-1],
-                // top state at j-1/2
-                rho - 0.5*srho_y[i][j],
-                u   - 0.5*su_y[i][j],
-                v   - 0.5*sv_y[i][j],
-                p   - 0.5*sp_y[i][j],
-                Bx  - 0.5*sbx_y[i][j],
-                By  - 0.5*sby_y[i][j],
-                psi - 0.5*spsi_y[i][j]
-            );
-            
-            // Update conserved variables
-            rho_new[i][j] = rho - dt/grid.dx * (flux_xp.F_rho - flux_xm.F_rho)
-                                - dt/grid.dy * (flux_yp.F_rho - flux_ym.F_rho);
-            
-            momx_new[i][j] = momx_new[i][j] - dt/grid.dx * (flux_xp.F_momx - flux_xm.F_momx)
-                                             - dt/grid.dy * (flux_yp.F_momx - flux_ym.F_momx);
-            
-            momy_new[i][j] = momy_new[i][j] - dt/grid.dx * (flux_xp.F_momy - flux_xm.F_momy)
-                                             - dt/grid.dy * (flux_yp.F_momy - flux_ym.F_momy);
-            
-            e_new[i][j] = flow.e.data[i][j] - dt/grid.dx * (flux_xp.F_E - flux_xm.F_E)
-                                            - dt/grid.dy * (flux_yp.F_E - flux_ym.F_E);
-            double ke_temp = 0.5 * rho_new[i][j] * (u*u + v*v);
-            double me_temp = 0.5 * (bx_new[i][j]*bx_new[i][j] + by_new[i][j]*by_new[i][j]);
-            if (e_new[i][j] < ke_temp + me_temp + 1e-10) {
-                std::cerr << "Warning: Insufficient total energy at ("<<i<<","<<j<<"), adjusting\n";
-                e_new[i][j] = ke_temp + me_temp + 1e-10;
-            }
-            
-            bx_new[i][j] = Bx - dt/grid.dx * (flux_xp.F_Bx - flux_xm.F_Bx)
-                              - dt/grid.dy * (flux_yp.F_Bx - flux_ym.F_Bx);
-            
-            by_new[i][j] = By - dt/grid.dx * (flux_xp.F_By - flux_xm.F_By)
-                              - dt/grid.dy * (flux_yp.F_By - flux_ym.F_By);
-            
-            psi_new[i][j] = psi - dt/grid.dx * (flux_xp.F_psi - flux_xm.F_psi)
-                                - dt/grid.dy * (flux_yp.F_psi - flux_ym.F_psi);
-            
-            // Add viscous terms
-            if (nu > 0) {
-                momx_new[i][j] += dt * nu * rho * laplacian(flow.u, i, j);
-                momy_new[i][j] += dt * nu * rho * laplacian(flow.v, i, j);
-            }
-            
-            // Add magnetic diffusion
-            if (ETA > 0) {
-                bx_new[i][j] += dt * ETA * laplacian(flow.bx, i, j);
-                by_new[i][j] += dt * ETA * laplacian(flow.by, i, j);
+
+    // Update conserved cells from the face fluxes
+    auto store = [&](int i, int j, const CellUpdate& c){
+        rho_new[i][j] = c.rho;
+        momx_new[i][j] = c.mx;
+        momy_new[i][j] = c.my;
+        e_new[i][j] = c.e;
+        bx_new[i][j] = c.bx;
+        by_new[i][j] = c.by;
+        psi_new[i][j] = c.psi;
+#ifdef MHD_2P5D
+        momz_new[i][j] = c.mz;
+        bz_new[i][j] = c.bz;
+#endif
+    };
+    auto advance = [&](int i, int j, const HLLFlux& xp, const HLLFlux& xm,
+                       const HLLFlux& yp, const HLLFlux& ym, double diffusion_weight){
+        return advance_cell<Phys>(flow, i, j, xp, xm, yp, ym, dt, nu, use_ct, use_glm, explicit_diffusion,
+                                  diffusion_weight);
+    };
+    auto update = [&](int i, int j, double diffusion_weight = 1.0){
+        return advance(i, j, fx[i][j], fx[i-1][j], fy[i][j], fy[i][j-1], diffusion_weight);
+    };
+    // Last resort when even the low-order update leaves a cell inadmissible;
+    // counted in SolverStats::floored_cells
+    long floored = 0;
+    auto floor_cell = [&](CellUpdate& c){
+        c.rho = std::max(c.rho, kPositivityFloor);
+        c.e = std::max(c.e, cell_energy_floor<Phys>(c));
+        ++floored;
+    };
+
+    // Inadmissible cells (legacy: energy-adjusted cells) are flagged in
+    // parallel and gathered in order afterwards; the loop bodies do no I/O
+    enum : char { kBad = 1, kAdjusted = 2, kNegative = 4 };
+    std::vector<char> flagged((size_t)nx*ny, 0);
+    auto warn_flagged = [&](char flag, const char* what, const char* action){
+        for (int i = 1; i < nx-1; ++i)
+            for (int j = 1; j < ny-1; ++j)
+                if (flagged[(size_t)i*ny + j] & flag)
+                    std::cerr << "Warning: " << what << " at (" << i << "," << j << ")" << action << "\n";
+    };
+    const long nbad = exec::reduce_2d(1, nx-1, 1, ny-1, 0L, std::plus<long>(), [&](int i, int j){
+        CellUpdate c = update(i, j);
+        long is_bad = 0;
+        if (!opts.positivity) {
+            // Legacy floors: patch the energy against the old velocity and field
+            double u = flow.u.data[i][j], v = flow.v.data[i][j];
+            double Bx = flow.bx.data[i][j], By = flow.by.data[i][j];
+            double ke_temp = 0.5 * c.rho * (u*u + v*v);
+            double me_temp = 0.5 * (Bx*Bx + By*By);
+#ifdef MHD_2P5D
+            double w = flow.w.data[i][j], Bz = flow.bz.data[i][j];
+            ke_temp += 0.5 * c.rho * w*w;
+            me_temp += 0.5 * Bz*Bz;
+#endif
+            if (c.e < ke_temp + me_temp + 1e-10) {
+                flagged[(size_t)i*ny + j] |= kAdjusted;
+                c.e = ke_temp + me_temp + 1e-10;
             }
-            
-            // GLM flux part handled above; divergence cleaning will be applied later
-            
-            // Ensure physical values
-            rho_new[i][j] = std::max(rho_new[i][j], 1e-10);
-            e_new[i][j]   = std::max(e_new[i][j], 1e-10);
+            c.rho = std::max(c.rho, 1e-10);
+            c.e   = std::max(c.e, 1e-10);
+        } else if (!is_admissible<Phys>(c)) {
+            flagged[(size_t)i*ny + j] = kBad;
+            is_bad = 1;
         }
+        store(i, j, c);
+        return is_bad;
+    });
+    if (!opts.positivity) warn_flagged(kAdjusted, "Insufficient total energy", ", adjusting");
+    std::vector<std::pair<int,int>> bad;
+    if (nbad > 0) {
+        bad.reserve(nbad);
+        for (int i = 1; i < nx-1; ++i)
+            for (int j = 1; j < ny-1; ++j)
+                if (flagged[(size_t)i*ny + j] & kBad) bad.emplace_back(i, j);
     }
-    
-    // Update primitive variables
-    #pragma omp parallel for collapse(2)
-    for (int i = 1; i < grid.nx-1; ++i) {
-        for (int j = 1; j < grid.ny-1; ++j) {
-            flow.rho.data[i][j] = rho_new[i][j];
-            flow.u.data[i][j] = momx_new[i][j] / rho_new[i][j];
-            flow.v.data[i][j] = momy_new[i][j] / rho_new[i][j];
-            flow.bx.data[i][j] = bx_new[i][j];
-            flow.by.data[i][j] = by_new[i][j];
-            flow.e.data[i][j]  = e_new[i][j];
-            
-            // Update pressure
-            double ke = 0.5 * rho_new[i][j] * (flow.u.data[i][j]*flow.u.data[i][j] +
-                                                flow.v.data[i][j]*flow.v.data[i][j]);
-            double me = 0.5 * (bx_new[i][j]*bx_new[i][j] + by_new[i][j]*by_new[i][j]);
-            double ie = e_new[i][j] - ke - me;
-            if (ie < 0)
-                std::cerr << "Warning: Negative internal energy at ("<<i<<","<<j<<")\n";
-            flow.p.data[i][j] = (gamma_gas - 1.0) * std::max(ie, 1e-10);
+
+    if (!bad.empty()) {
+        PositivityResult lim = limit_positivity<Phys>(flow, fx, fy, bad, advance,
+                                                        use_ct ? &bxf_n : nullptr, use_ct ? &byf_n : nullptr);
+        for (auto [i, j] : lim.cells) {
+            CellUpdate c = update(i, j, lim.diffusion[(size_t)i*ny + j]);
+            if (!is_admissible<Phys>(c)) floor_cell(c);
+            store(i, j, c);
         }
+        if (opts.stats) opts.stats->limited_faces += lim.faces;
+    }
+    if (opts.stats) opts.stats->floored_cells += floored;
+    if (opts.health) opts.health->floored += floored;
+    
+    // Update primitive variables, counting unhealthy cells on the way
+    using Counts = std::pair<long, long>;   // nonfinite, negative
+    auto add_counts = [](Counts a, Counts b){ return Counts{a.first + b.first, a.second + b.second}; };
+    const auto [nonfinite, negative] = exec::reduce_2d(1, nx-1, 1, ny-1, Counts{0, 0}, add_counts, [&](int i, int j){
+        flow.rho.data[i][j] = rho_new[i][j];
+        flow.u.data[i][j] = momx_new[i][j] / rho_new[i][j];
+        flow.v.data[i][j] = momy_new[i][j] / rho_new[i][j];
+        flow.bx.data[i][j] = bx_new[i][j];
+        flow.by.data[i][j] = by_new[i][j];
+        flow.e.data[i][j]  = e_new[i][j];
+        
+        // Update pressure
+        double ke = 0.5 * rho_new[i][j] * (flow.u.data[i][j]*flow.u.data[i][j] +
+                                            flow.v.data[i][j]*flow.v.data[i][j]);
+        double me = 0.5 * (bx_new[i][j]*bx_new[i][j] + by_new[i][j]*by_new[i][j]);
+#ifdef MHD_2P5D
+        flow.w.data[i][j]  = momz_new[i][j] / rho_new[i][j];
+        flow.bz.data[i][j] = bz_new[i][j];
+        ke += 0.5 * rho_new[i][j] * flow.w.data[i][j]*flow.w.data[i][j];
+        me += 0.5 * bz_new[i][j]*bz_new[i][j];
+#endif
+        double ie = e_new[i][j] - ke - me;
+        if (ie < 0 && !opts.positivity) flagged[(size_t)i*ny + j] |= kNegative;
+        flow.p.data[i][j] = (Phys::gamma - 1.0) * std::max(ie, 1e-10);
+        if (!std::isfinite(ie + momx_new[i][j] + momy_new[i][j] + psi_new[i][j])) return Counts{1, 0};
+        return Counts{0, ie < 0 || rho_new[i][j] <= 0};
+    });
+    if (!opts.positivity) warn_flagged(kNegative, "Negative internal energy", "");
+    if (opts.health) {
+        opts.health->nonfinite += nonfinite;
+        opts.health->negative_pressure += negative;
     }
     
     // Boundary conditions (periodic)
-    #pragma omp parallel for
-    for (int j = 0; j < grid.ny; ++j) {
+    exec::for_each(0, ny, [&](long j){
         // X direction periodic BC using modulo indices
-        int left_src  = (grid.nx + 0 - 2) % grid.nx;  // nx-2
-        int right_src = (grid.nx - 1 + 2) % grid.nx;  // 1
+        int left_src  = (nx + 0 - 2) % nx;  // nx-2
+        int right_src = (nx - 1 + 2) % nx;  // 1
         flow.rho.data[0][j] = flow.rho.data[left_src][j];
-        flow.rho.data[grid.nx-1][j] = flow.rho.data[right_src][j];
+        flow.rho.data[nx-1][j] = flow.rho.data[right_src][j];
         flow.u.data[0][j] = flow.u.data[left_src][j];
-        flow.u.data[grid.nx-1][j] = flow.u.data[right_src][j];
+        flow.u.data[nx-1][j] = flow.u.data[right_src][j];
         flow.v.data[0][j] = flow.v.data[left_src][j];
-        flow.v.data[grid.nx-1][j] = flow.v.data[right_src][j];
+        flow.v.data[nx-1][j] = flow.v.data[right_src][j];
         flow.p.data[0][j] = flow.p.data[left_src][j];
-        flow.p.data[grid.nx-1][j] = flow.p.data[right_src][j];
+        flow.p.data[nx-1][j] = flow.p.data[right_src][j];
         flow.e.data[0][j] = flow.e.data[left_src][j];
-        flow.e.data[grid.nx-1][j] = flow.e.data[right_src][j];
+        flow.e.data[nx-1][j] = flow.e.data[right_src][j];
         flow.bx.data[0][j] = flow.bx.data[left_src][j];
-        flow.bx.data[grid.nx-1][j] = flow.bx.data[right_src][j];
+        flow.bx.data[nx-1][j] = flow.bx.data[right_src][j];
         flow.by.data[0][j] = flow.by.data[left_src][j];
-        flow.by.data[grid.nx-1][j] = flow.by.data[right_src][j];
+        flow.by.data[nx-1][j] = flow.by.data[right_src][j];
         flow.psi.data[0][j] = flow.psi.data[left_src][j];
-        flow.psi.data[grid.nx-1][j] = flow.psi.data[right_src][j];
-    }
+        flow.psi.data[nx-1][j] = flow.psi.data[right_src][j];
+#ifdef MHD_2P5D
+        flow.w.data[0][j] = flow.w.data[left_src][j];
+        flow.w.data[nx-1][j] = flow.w.data[right_src][j];
+        flow.bz.data[0][j] = flow.bz.data[left_src][j];
+        flow.bz.data[nx-1][j] = flow.bz.data[right_src][j];
+#endif
+    });
     
-    #pragma omp parallel for
-    for (int i = 0; i < grid.nx; ++i) {
+    exec::for_each(0, nx, [&](long i){
         // Y direction periodic BC using modulo indices
-        int bot_src = (grid.ny + 0 - 2) % grid.ny;  // ny-2
-        int top_src = (grid.ny - 1 + 2) % grid.ny;  // 1
+        int bot_src = (ny + 0 - 2) % ny;  // ny-2
+        int top_src = (ny - 1 + 2) % ny;  // 1
         flow.rho.data[i][0] = flow.rho.data[i][bot_src];
-        flow.rho.data[i][grid.ny-1] = flow.rho.data[i][top_src];
+        flow.rho.data[i][ny-1] = flow.rho.data[i][top_src];
         flow.u.data[i][0] = flow.u.data[i][bot_src];
-        flow.u.data[i][grid.ny-1] = flow.u.data[i][top_src];
+        flow.u.data[i][ny-1] = flow.u.data[i][top_src];
         flow.v.data[i][0] = flow.v.data[i][bot_src];
-        flow.v.data[i][grid.ny-1] = flow.v.data[i][top_src];
+        flow.v.data[i][ny-1] = flow.v.data[i][top_src];
         flow.p.data[i][0] = flow.p.data[i][bot_src];
-        flow.p.data[i][grid.ny-1] = flow.p.data[i][top_src];
+        flow.p.data[i][ny-1] = flow.p.data[i][top_src];
         flow.e.data[i][0] = flow.e.data[i][bot_src];
-        flow.e.data[i][grid.ny-1] = flow.e.data[i][top_src];
+        flow.e.data[i][ny-1] = flow.e.data[i][top_src];
         flow.bx.data[i][0] = flow.bx.data[i][bot_src];
-        flow.bx.data[i][grid.ny-1] = flow.bx.data[i][top_src];
+        flow.bx.data[i][ny-1] = flow.bx.data[i][top_src];
         flow.by.data[i][0] = flow.by.data[i][bot_src];
-        flow.by.data[i][grid.ny-1] = flow.by.data[i][top_src];
+        flow.by.data[i][ny-1] = flow.by.data[i][top_src];
         flow.psi.data[i][0] = flow.psi.data[i][bot_src];
-        flow.psi.data[i][grid.ny-1] = flow.psi.data[i][top_src];
+        flow.psi.data[i][ny-1] = flow.psi.data[i][top_src];
+#ifdef MHD_2P5D
+        flow.w.data[i][0] = flow.w.data[i][bot_src];
+        flow.w.data[i][ny-1] = flow.w.data[i][top_src];
+        flow.bz.data[i][0] = flow.bz.data[i][bot_src];
+        flow.bz.data[i][ny-1] = flow.bz.data[i][top_src];
+#endif
+    });
+
+    // GLM divergence cleaning on the interior, then the periodic ghosts. The
+    // divergence wraps over the interior: bx_new and by_new still hold the
+    // start-of-step ghosts.
+    if (use_glm) {
+        const stencil::InteriorWrap P{nx, ny};
+        exec::for_2d(1, nx-1, 1, ny-1, [&](int i, int j){
+            double divB_new = stencil::divergence(bx_new, by_new, grid.dx, grid.dy, i, j, P);
+            flow.psi.data[i][j] = psi_new[i][j] - dt*Phys::ch*Phys::ch*divB_new
+                                   - dt*Phys::cr*psi_new[i][j];
+        });
+        exec::for_each(0, ny, [&](long j){
+            flow.psi.data[0][j] = flow.psi.data[nx-2][j];
+            flow.psi.data[nx-1][j] = flow.psi.data[1][j];
+        });
+        exec::for_each(0, nx, [&](long i){
+            flow.psi.data[i][0] = flow.psi.data[i][ny-2];
+            flow.psi.data[i][ny-1] = flow.psi.data[i][1];
+        });
+    }
+
+    if (mask) {
+        fx.buf.swap(mask->fx);
+        fy.buf.swap(mask->fy);
+        mask->end(flow);
+        if (opts.stats) opts.stats->skipped_cells += mask->skipped();
     }
+    return dt;
+}
+
+// Pressure from total energy after an operator-split update of the velocity and field
+template <class Phys>
+static void update_pressure(FlowField& flow){
+    auto ie = flow.e - 0.5*flow.rho*(flow.u*flow.u + flow.v*flow.v) - 0.5*(flow.bx*flow.bx + flow.by*flow.by);
+#ifdef MHD_2P5D
+    flow.p = (Phys::gamma - 1.0) * max(ie - (0.5*flow.rho*flow.w*flow.w + 0.5*flow.bz*flow.bz), 1e-10);
+#else
+    flow.p = (Phys::gamma - 1.0) * max(ie, 1e-10);
+#endif
+}
+
+double compute_parabolic_timestep(const FlowField& flow, double nu){
+    return std::min(compute_diffusion_timestep(flow.u, nu),
+                    compute_diffusion_timestep(flow.bx, RuntimePhysics::eta));
+}
+
+template <class Phys>
+static void solve_step(FlowField& flow, double dt, double nu, const SolverOptions& opts){
+    if (opts.health) *opts.health = StepHealth{};
+    if (opts.lts_levels > 1 && opts.divb != DivBScheme::CT) {
+        dt = lts_update(flow, dt, nu, opts);
+    } else {
+        if (opts.split)
+            dt = split_update(flow, dt, nu, opts);
+        else
+            dt = dispatch_dims(flow.rho.nx, flow.rho.ny, opts.fixed_size, [&](auto dims){
+                return update_level<Phys>(flow, dt, nu, opts, dims);
+            });
+        if (opts.stats) {
+            long cells = (long)(flow.rho.nx-2) * (flow.rho.ny-2);
+            opts.stats->cell_updates += cells;
+            opts.stats->cell_updates_global += cells;
+            opts.stats->time += dt;
+        }
+    }
+    ++flow.steps;
 
-    // GLM divergence cleaning including boundaries
-    #pragma omp parallel for collapse(2)
-    for(int i=0;i<grid.nx;++i){
-        for(int j=0;j<grid.ny;++j){
-            int ip=(i+1)%grid.nx, im=(i-1+grid.nx)%grid.nx;
-            int jp=(j+1)%grid.ny, jm=(j-1+grid.ny)%grid.ny;
-            double divB_new = (bx_new[ip][j] - bx_new[im][j])/(2*grid.dx)
-                            + (by_new[i][jp] - by_new[i][jm])/(2*grid.dy);
-            flow.psi.data[i][j] = psi_new[i][j] - dt*CH*CH*divB_new
-                                   - dt*CR*psi_new[i][j];
+    if (opts.diffusion != DiffusionScheme::Explicit) {
+        // CT keeps resistivity in the corner EMF to preserve div B
+        std::vector<DiffusedField> fields = {{&flow.u, nu}, {&flow.v, nu}};
+        if (opts.divb != DivBScheme::CT) {
+            fields.push_back({&flow.bx, Phys::eta});
+            fields.push_back({&flow.by, Phys::eta});
         }
+#ifdef MHD_2P5D
+        fields.push_back({&flow.w, nu});
+        fields.push_back({&flow.bz, Phys::eta});
+#endif
+        if (opts.diffusion == DiffusionScheme::RKL2)
+            diffuse_rkl2(fields, dt);
+        else
+            diffuse_implicit(fields, dt, opts.diffusion == DiffusionScheme::CrankNicolson ? 0.5 : 1.0);
+        update_pressure<Phys>(flow);
     }
+
+    int every = opts.projection_every;
+    if (opts.divb == DivBScheme::Projection && every <= 0) every = 1;
+    if (opts.divb != DivBScheme::CT && every > 0 && flow.steps % every == 0)
+        project_divergence_free(flow);
+}
+
+void solve_MHD(FlowField& flow, double dt, double nu, const SolverOptions& opts){
+    dispatch_physics([&](auto phys){ solve_step<decltype(phys)>(flow, dt, nu, opts); });
+}
+
+double compute_cfl_timestep(const FlowField& flow, double cfl_number){
+    return dispatch_physics([&](auto phys){ return cfl_timestep<decltype(phys)>(flow, cfl_number); });
+}
+
+void set_physics_params(const PhysicsParams& params){
+    RuntimePhysics::eta = params.eta;
+    RuntimePhysics::ch = params.ch;
+    RuntimePhysics::cr = params.cr;
+    RuntimePhysics::gamma = params.gamma;
 }
 
-void solve_MHD(FlowField& flow, double dt, double nu){
-    update_level(flow, dt, nu);
+PhysicsParams get_physics_params(){
+    return {RuntimePhysics::eta, RuntimePhysics::ch, RuntimePhysics::cr, RuntimePhysics::gamma};
 }
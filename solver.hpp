@@ -1,6 +1,99 @@
 #pragma once
 #include "grid.hpp"
-void solve_MHD(FlowField& flow, double dt, double nu);
+
+// Built-in physics constants
+struct DefaultPhysics {
+    static constexpr double eta = 0.001;     // Magnetic diffusivity
+    static constexpr double ch = 0.8;        // GLM wave speed
+    static constexpr double cr = 0.01;       // GLM damping coefficient (improved value)
+    static constexpr double gamma = 5.0/3.0;
+};
+
+struct PhysicsParams {
+    double eta = DefaultPhysics::eta;
+    double ch = DefaultPhysics::ch;
+    double cr = DefaultPhysics::cr;
+    double gamma = DefaultPhysics::gamma;
+};
+
+// Physics constants used by all subsequent solver calls
+void set_physics_params(const PhysicsParams& params);
+PhysicsParams get_physics_params();
+
+// Treatment of the div B constraint
+enum class DivBScheme {
+    GLM,   // hyperbolic/parabolic cleaning with psi
+    CT,    // face-centred constrained transport (bxf/byf), div B at round-off
+    Projection  // no psi; FFT projection every projection_every steps (1 if unset)
+};
+
+// Treatment of the nu and ETA Laplacian terms
+enum class DiffusionScheme {
+    Explicit,  // inside the hyperbolic update, limited by compute_parabolic_timestep
+    RKL2,      // operator-split RKL2 super-time-stepping, stages chosen per step
+    CrankNicolson,  // operator-split implicit, multigrid solve
+    BackwardEuler
+};
+
+// Face Riemann solver of the 2-D update (not LTS; the positivity limiter's
+// first-order fallback stays HLL)
+enum class RiemannSolver {
+    HLL,
+    Rusanov,   // local Lax-Friedrichs: cheaper, more diffusive
+    Hybrid     // Rusanov on smooth faces, HLL where the jump indicator exceeds riemann_threshold
+};
+
+// Work counters accumulated by solve_MHD when SolverOptions::stats is set
+struct SolverStats {
+    long cell_updates = 0;         // interior cell updates performed
+    long cell_updates_global = 0;  // updates a global-CFL-dt run needs for the same time
+    double time = 0.0;             // simulated time covered
+    long limited_faces = 0;        // faces blended towards first order by the positivity limiter
+    long floored_cells = 0;        // cells the limiter could not save and had to floor
+    long skipped_cells = 0;        // cell updates that reused stored fluxes (activity mask)
+    long rusanov_faces = 0;        // face fluxes per solver, counted for riemann = rusanov or hybrid
+    long hll_faces = 0;
+};
+
+// Health of the state after one solve_MHD step, counted in the update's
+// primitive-variable pass when SolverOptions::health is set
+struct StepHealth {
+    long nonfinite = 0;            // cells with a NaN or Inf conserved value
+    long negative_pressure = 0;    // cells with rho <= 0 or negative internal energy (before the floor)
+    long floored = 0;              // cells the positivity limiter could not save and had to floor
+    bool ok() const { return nonfinite == 0 && negative_pressure == 0 && floored == 0; }
+};
+
+struct ActivityMask;   // activity.hpp
+
+struct SolverOptions {
+    double cfl = 0.2;           // CFL number, also caps dt inside the update
+    DivBScheme divb = DivBScheme::GLM;
+    int projection_every = 0;   // > 0: FFT projection cleaning every N steps (complements GLM)
+    DiffusionScheme diffusion = DiffusionScheme::Explicit;
+    int lts_levels = 1;         // > 1: block-local time stepping with up to this many power-of-two levels (not with CT)
+    int lts_block = 16;         // LTS block edge in cells
+    bool positivity = true;     // positivity-preserving flux limiter instead of the legacy rho/E floors
+    bool fixed_size = true;     // run a compile-time grid-size specialisation when one matches (64^2, 128^2)
+    double activity_tol = 0.0;  // > 0: tiles drifting less than this keep their fluxes (needs activity; not with LTS)
+    int activity_tile = 16;     // activity tile edge in cells
+    RiemannSolver riemann = RiemannSolver::HLL;
+    double riemann_threshold = 0.1;   // hybrid: relative pressure or |B|^2/2 jump that selects HLL
+    bool split = false;         // Strang dimensional splitting with 1-D sweeps (split.hpp) instead of the unsplit update
+    bool split_transpose = false;   // split: x sweep on a tiled transpose instead of strided column gathers
+    ActivityMask* activity = nullptr;   // state carried between steps by the activity mask
+    SolverStats* stats = nullptr;
+    StepHealth* health = nullptr;   // reset and filled by every solve_MHD step
+};
+
+void solve_MHD(FlowField& flow, double dt, double nu, const SolverOptions& opts = SolverOptions());
 // Estimate stable timestep based on CFL condition
 double compute_cfl_timestep(const FlowField& flow, double cfl_number = 0.2);
-std::pair<double, double> compute_divergence_errors(const FlowField& flow);  // Add this line
+// Forward-Euler limit of the explicit nu and ETA diffusion terms
+double compute_parabolic_timestep(const FlowField& flow, double nu);
+// Max and mean |div B| over the interior cells
+std::pair<double, double> compute_divergence_errors(const FlowField& flow);
+// Centred current density Jz = dBy/dx - dBx/dy and vorticity dv/dx - du/dy on
+// the interior cells, ghosts filled periodically
+Grid compute_current_density(const FlowField& flow);
+Grid compute_vorticity(const FlowField& flow);
@@ -0,0 +1,314 @@
+#include "solver3d.hpp"
+#include "riemann.hpp"
+#include "exec.hpp"
+#include <cmath>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+
+// The primitive ring uses the Var3D slots: rho, u, v, w, p, bx, by, bz, psi
+// in RHO3, MX3, MY3, MZ3, EN3, BX3, BY3, BZ3, PSI3.
+using Fields3D = double* const*;   // NVAR3D pointers into one plane
+
+// CFL limit of cell c, from the conserved state
+template <class Phys>
+static inline double cell_timestep_3d(const Grid3D& g, const double* const* U, size_t c){
+    double r = U[RHO3][c];
+    double u = U[MX3][c]/r, v = U[MY3][c]/r, w = U[MZ3][c]/r;
+    double bx = U[BX3][c], by = U[BY3][c], bz = U[BZ3][c];
+    double B2 = bx*bx + by*by + bz*bz;
+    double p = (Phys::gamma - 1.0) * (U[EN3][c] - 0.5*r*(u*u + v*v + w*w) - 0.5*B2);
+    double cf = std::sqrt((Phys::gamma*p + B2) / r);
+    return std::min(std::min(g.dx / (std::abs(u) + cf),
+                             g.dy / (std::abs(v) + cf)),
+                             g.dz / (std::abs(w) + cf));
+}
+
+template <class Phys>
+static double cfl_timestep_3d(const FlowField3D& flow, double cfl_number){
+    const Grid3D& g = flow.grid;
+    double dt_min = 1e10;
+    if(flow.cfl_cache.step == flow.steps && flow.cfl_cache.gamma == Phys::gamma){
+        dt_min = flow.cfl_cache.dt_min;   // measured during the last sweep
+    } else {
+        const double* U[NVAR3D];
+        for(int v = 0; v < NVAR3D; ++v) U[v] = flow.var(v);
+
+        auto min = [](double a, double b){ return std::min(a, b); };
+        dt_min = exec::reduce_2d(0, g.nx, 0, g.ny, dt_min, min, [&](int i, int j){
+            const size_t row = g.idx(i,j,0);
+            double m = 1e10;
+            #pragma omp simd reduction(min:m)
+            for(int k = 0; k < g.nz; ++k)
+                m = std::min(m, cell_timestep_3d<Phys>(g, U, row + k));
+            return m;
+        });
+    }
+
+    double dt_glm = std::min(std::min(g.dx, g.dy), g.dz) / Phys::ch;
+    if(dt_min > 1.0) // prevent unrealistically large dt due to NaNs
+        dt_min = dt_glm;
+    return cfl_number * std::min(dt_min, dt_glm);
+}
+
+// MUSCL states either side of the face between a0[s] and ap[s+d], from the
+// four cells am[s-d], a0[s], ap[s+d], app[s+2d]. Along y and z the four planes
+// are the same and d is the stride; along x they are consecutive ring planes and d = 0.
+template <class Phys, int D>
+static inline void face_flux(Fields3D am, Fields3D a0, Fields3D ap, Fields3D app,
+                             ptrdiff_t s, ptrdiff_t d, Fields3D F, ptrdiff_t f){
+    constexpr int n = D, t1 = (D+1)%3, t2 = (D+2)%3;
+    auto recon = [&](int v, double& l, double& r){
+        double m = am[v][s-d], c = a0[v][s], p = ap[v][s+d], pp = app[v][s+2*d];
+        l = c + 0.5*minmod(c - m, p - c);
+        r = p - 0.5*minmod(p - c, pp - p);
+    };
+    State3D L, R;
+    recon(RHO3,    L.rho, R.rho);
+    recon(MX3+n,   L.vn,  R.vn);
+    recon(MX3+t1,  L.vt1, R.vt1);
+    recon(MX3+t2,  L.vt2, R.vt2);
+    recon(EN3,     L.p,   R.p);
+    recon(BX3+n,   L.bn,  R.bn);
+    recon(BX3+t1,  L.bt1, R.bt1);
+    recon(BX3+t2,  L.bt2, R.bt2);
+    recon(PSI3,    L.psi, R.psi);
+
+    Flux3D fl = compute_hll_flux_3d<Phys>(L, R);
+    F[RHO3][f]   = fl.rho;
+    F[MX3+n][f]  = fl.mn;
+    F[MX3+t1][f] = fl.mt1;
+    F[MX3+t2][f] = fl.mt2;
+    F[EN3][f]    = fl.e;
+    F[BX3+n][f]  = fl.bn;
+    F[BX3+t1][f] = fl.bt1;
+    F[BX3+t2][f] = fl.bt2;
+    F[PSI3][f]   = fl.psi;
+}
+
+template <class Phys>
+static double update_3d(FlowField3D& flow, double dt, double nu, const SolverOptions& opts){
+    const Grid3D& g = flow.grid;
+    constexpr int ng = Grid3D::ng;
+    dt = std::min(dt, cfl_timestep_3d<Phys>(flow, opts.cfl));
+
+    // Scratch: 4 primitive planes, 2 x-face flux planes, y- and z-face fluxes of the current plane
+    const size_t P = g.plane();
+    thread_local std::vector<double, HugePageAllocator<double>> work;
+    if(work.size() < 8*NVAR3D*P) work.resize(8*NVAR3D*P);
+    double* ring[4][NVAR3D];
+    double* fx[2][NVAR3D];
+    double* fy[NVAR3D];
+    double* fz[NVAR3D];
+    for(int v = 0; v < NVAR3D; ++v){
+        for(int r = 0; r < 4; ++r) ring[r][v] = work.data() + (r*NVAR3D + v)*P;
+        for(int r = 0; r < 2; ++r) fx[r][v] = work.data() + ((4+r)*NVAR3D + v)*P;
+        fy[v] = work.data() + (6*NVAR3D + v)*P;
+        fz[v] = work.data() + (7*NVAR3D + v)*P;
+    }
+    // Plane i is held in ring slot (i+ng)%4; face i+1/2 in fx[(i+ng)%2]
+    auto W  = [&](int i){ return (Fields3D)ring[(i + ng) % 4]; };
+    auto FX = [&](int i){ return (Fields3D)fx[(i + ng) % 2]; };
+
+    double* U[NVAR3D];
+    for(int v = 0; v < NVAR3D; ++v) U[v] = flow.var(v);
+    const ptrdiff_t dj = g.sz;   // y-neighbour within a plane
+    const double cx = dt/g.dx, cy = dt/g.dy, cz = dt/g.dz;
+    const double idx2 = 1.0/(g.dx*g.dx), idy2 = 1.0/(g.dy*g.dy), idz2 = 1.0/(g.dz*g.dz);
+
+    // Out of core, the state is paged in slabs: while slab s is swept the next
+    // one is read in the background, and the previous one is written back.
+    const bool paged = flow.out_of_core();
+    const int slab = std::max(flow.slab_planes, 1);
+    if(paged) flow.prefetch_planes(-ng, 2 + slab);
+    double dt_next = 1e10;   // CFL limit of the new state, for the next step
+
+    // Conserved -> primitive for a whole plane, ghosts included
+    auto to_primitive = [&](int i){
+        const size_t base = g.idx(i,-ng,-ng);
+        const double *r = U[RHO3]+base, *mx = U[MX3]+base, *my = U[MY3]+base, *mz = U[MZ3]+base;
+        const double *en = U[EN3]+base, *bx = U[BX3]+base, *by = U[BY3]+base, *bz = U[BZ3]+base;
+        const double *psi = U[PSI3]+base;
+        Fields3D w = W(i);
+        double *wr = w[RHO3], *wu = w[MX3], *wv = w[MY3], *ww = w[MZ3], *wp = w[EN3];
+        double *wbx = w[BX3], *wby = w[BY3], *wbz = w[BZ3], *wpsi = w[PSI3];
+        exec::for_blocks(0, (long)P, [&](long sb, long se){
+            #pragma omp simd
+            for(long s = sb; s < se; ++s){
+                double inv = 1.0 / r[s];
+                double u = mx[s]*inv, v = my[s]*inv, vz = mz[s]*inv;
+                wr[s] = r[s]; wu[s] = u; wv[s] = v; ww[s] = vz;
+                wp[s] = (Phys::gamma - 1.0) * (en[s] - 0.5*r[s]*(u*u + v*v + vz*vz)
+                                               - 0.5*(bx[s]*bx[s] + by[s]*by[s] + bz[s]*bz[s]));
+                wbx[s] = bx[s]; wby[s] = by[s]; wbz[s] = bz[s]; wpsi[s] = psi[s];
+            }
+        });
+    };
+    // x-faces i+1/2 of row j over the interior k
+    auto x_faces = [&](int i, int j){
+        Fields3D am = W(i-1), a0 = W(i), ap = W(i+1), app = W(i+2), F = FX(i);
+        const ptrdiff_t row = (ptrdiff_t)(j+ng)*dj + ng;
+        #pragma omp simd
+        for(int k = 0; k < g.nz; ++k)
+            face_flux<Phys,0>(am, a0, ap, app, row+k, 0, F, row+k);
+    };
+    auto min = [](double a, double b){ return std::min(a, b); };
+
+    for(int i = -ng; i < 2; ++i) to_primitive(i);
+    exec::for_each(0, g.ny, [&](long j){ x_faces(-1, (int)j); });
+    for(int i = 0; i < g.nx; ++i){
+        if(paged && i % slab == 0){
+            flow.prefetch_planes(i + 2 + slab, i + 2 + 2*slab);   // to_primitive runs two planes ahead
+            flow.release_planes(i - slab, i);
+        }
+        to_primitive(i+2);   // overwrites plane i-2, last read by the previous plane's update
+
+        // Faces of plane i, row by row: x-faces i+1/2 and z-faces k+1/2 for
+        // k = -1..nz-1 on rows 0..ny-1, y-faces j+1/2 for j = -1..ny-1
+        Fields3D w0 = W(i), wm = W(i-1), wp = W(i+1);
+        exec::for_each(-1, g.ny, [&](long jl){
+            const int j = (int)jl;
+            const ptrdiff_t row = (ptrdiff_t)(j+ng)*dj + ng;
+            #pragma omp simd
+            for(int k = 0; k < g.nz; ++k)
+                face_flux<Phys,1>(w0, w0, w0, w0, row+k, dj, fy, row+k);
+            if(j < 0) return;
+            x_faces(i, j);
+            #pragma omp simd
+            for(int k = -1; k < g.nz; ++k)
+                face_flux<Phys,2>(w0, w0, w0, w0, row+k, 1, fz, row+k);
+        });
+
+        // Update plane i in place, row by row; each row is then final, so take
+        // its CFL limit and fill its periodic z ghosts (as apply_periodic_bc_3d,
+        // whose y step follows and whose x step follows the sweep)
+        Fields3D flo = FX(i-1), fhi = FX(i);
+        const size_t base = g.idx(i,-ng,-ng);
+        const double dt_plane = exec::reduce_2d(0, g.ny, 0, 1, 1e10, min, [&](int j, int){
+            const ptrdiff_t row = (ptrdiff_t)(j+ng)*dj + ng;
+            #pragma omp simd
+            for(int k = 0; k < g.nz; ++k){
+                const ptrdiff_t s = row + k;
+                const size_t c = base + s;
+                double un[NVAR3D];
+                for(int v = 0; v < NVAR3D; ++v)
+                    un[v] = U[v][c] - cx*(fhi[v][s] - flo[v][s])
+                                    - cy*(fy[v][s] - fy[v][s-dj])
+                                    - cz*(fz[v][s] - fz[v][s-1]);
+
+                auto lap = [&](int v){
+                    return (wp[v][s] - 2*w0[v][s] + wm[v][s])*idx2
+                         + (w0[v][s+dj] - 2*w0[v][s] + w0[v][s-dj])*idy2
+                         + (w0[v][s+1] - 2*w0[v][s] + w0[v][s-1])*idz2;
+                };
+                // Viscous and resistive terms
+                if(nu > 0){
+                    const double rnu = dt * nu * w0[RHO3][s];
+                    un[MX3] += rnu * lap(MX3);
+                    un[MY3] += rnu * lap(MY3);
+                    un[MZ3] += rnu * lap(MZ3);
+                }
+                if(Phys::eta > 0){
+                    un[BX3] += dt * Phys::eta * lap(BX3);
+                    un[BY3] += dt * Phys::eta * lap(BY3);
+                    un[BZ3] += dt * Phys::eta * lap(BZ3);
+                }
+                // GLM damping
+                un[PSI3] -= dt * Phys::cr * w0[PSI3][s];
+
+                // Ensure physical values
+                un[RHO3] = std::max(un[RHO3], 1e-10);
+                double floor_e = 0.5*(un[MX3]*un[MX3] + un[MY3]*un[MY3] + un[MZ3]*un[MZ3])/un[RHO3]
+                               + 0.5*(un[BX3]*un[BX3] + un[BY3]*un[BY3] + un[BZ3]*un[BZ3]) + 1e-10;
+                un[EN3] = std::max(un[EN3], floor_e);
+
+                for(int v = 0; v < NVAR3D; ++v) U[v][c] = un[v];
+            }
+
+            const size_t cells = g.idx(i,j,0);
+            double m = 1e10;
+            #pragma omp simd reduction(min:m)
+            for(int k = 0; k < g.nz; ++k)
+                m = std::min(m, cell_timestep_3d<Phys>(g, U, cells + k));
+            for(int v = 0; v < NVAR3D; ++v)
+                for(int l = 1; l <= ng; ++l){
+                    U[v][g.idx(i,j,-l)]       = U[v][g.idx(i,j,g.nz-l)];
+                    U[v][g.idx(i,j,g.nz-1+l)] = U[v][g.idx(i,j,l-1)];
+                }
+            return m;
+        });
+        dt_next = std::min(dt_next, dt_plane);
+        exec::for_each(0, NVAR3D, [&](long v){
+            for(int l = 1; l <= ng; ++l)
+                for(int k = -ng; k < g.nz+ng; ++k){
+                    U[v][g.idx(i,-l,k)]       = U[v][g.idx(i,g.ny-l,k)];
+                    U[v][g.idx(i,g.ny-1+l,k)] = U[v][g.idx(i,l-1,k)];
+                }
+        });
+    }
+
+    // x ghost planes, whole planes so edges and corners stay periodic
+    for(int v = 0; v < NVAR3D; ++v)
+        for(int l = 1; l <= ng; ++l){
+            double* a = U[v];
+            std::copy(a + g.idx(g.nx-l,-ng,-ng), a + g.idx(g.nx-l+1,-ng,-ng), a + g.idx(-l,-ng,-ng));
+            std::copy(a + g.idx(l-1,-ng,-ng), a + g.idx(l,-ng,-ng), a + g.idx(g.nx-1+l,-ng,-ng));
+        }
+    if(paged) flow.release_planes(g.nx - slab - ng, g.nx + ng);
+
+    flow.cfl_cache = {flow.steps + 1, dt_next, Phys::gamma};   // solve_step_3d counts the step
+    return dt;
+}
+
+template <class Phys>
+static void solve_step_3d(FlowField3D& flow, double dt, double nu, const SolverOptions& opts){
+    if(opts.divb != DivBScheme::GLM || opts.projection_every > 0 ||
+       opts.diffusion != DiffusionScheme::Explicit || opts.lts_levels > 1)
+        throw std::invalid_argument("solve_MHD_3d: only GLM cleaning with explicit diffusion is available in 3-D");
+
+    dt = update_3d<Phys>(flow, dt, nu, opts);
+    ++flow.steps;
+    if(opts.stats){
+        long cells = (long)flow.grid.nx * flow.grid.ny * flow.grid.nz;
+        opts.stats->cell_updates += cells;
+        opts.stats->cell_updates_global += cells;
+        opts.stats->time += dt;
+    }
+}
+
+void solve_MHD_3d(FlowField3D& flow, double dt, double nu, const SolverOptions& opts){
+    dispatch_physics([&](auto phys){ solve_step_3d<decltype(phys)>(flow, dt, nu, opts); });
+}
+
+double compute_cfl_timestep_3d(const FlowField3D& flow, double cfl_number){
+    return dispatch_physics([&](auto phys){ return cfl_timestep_3d<decltype(phys)>(flow, cfl_number); });
+}
+
+double compute_parabolic_timestep_3d(const FlowField3D& flow, double nu){
+    const Grid3D& g = flow.grid;
+    double c = std::max(nu, RuntimePhysics::eta);
+    if(c <= 0.0) return 1e10;
+    return 0.5 / (c * (1.0/(g.dx*g.dx) + 1.0/(g.dy*g.dy) + 1.0/(g.dz*g.dz)));
+}
+
+std::pair<double, double> compute_divergence_errors_3d(const FlowField3D& flow){
+    const Grid3D& g = flow.grid;
+    const double *bx = flow.var(BX3), *by = flow.var(BY3), *bz = flow.var(BZ3);
+    const ptrdiff_t di = (ptrdiff_t)g.plane(), dj = g.sz;
+    using MaxSum = std::pair<double, double>;   // max and sum of |div B|
+    auto combine = [](MaxSum a, MaxSum b){ return MaxSum{std::max(a.first, b.first), a.second + b.second}; };
+    auto [max_divB, L1_divB] = exec::reduce_2d(0, g.nx, 0, g.ny, MaxSum{0.0, 0.0}, combine, [&](int i, int j){
+        const size_t row = g.idx(i,j,0);
+        MaxSum r{0.0, 0.0};
+        for(int k = 0; k < g.nz; ++k){
+            size_t c = row + k;
+            double divB = (bx[c+di] - bx[c-di]) / (2*g.dx)
+                        + (by[c+dj] - by[c-dj]) / (2*g.dy)
+                        + (bz[c+1] - bz[c-1]) / (2*g.dz);
+            r = combine(r, MaxSum{std::abs(divB), std::abs(divB)});
+        }
+        return r;
+    });
+    return {max_divB, L1_divB / ((double)g.nx * g.ny * g.nz)};
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "grid3d.hpp"
+#include "solver.hpp"
+#include <utility>
+
+// 3-D MHD with GLM cleaning on a periodic box: MUSCL-minmod reconstruction,
+// HLL fluxes on x-, y- and z-faces, explicit nu and ETA diffusion.
+//
+// The update is done in place, sweeping x-planes: primitives live in a ring of
+// four planes and face fluxes in single-plane buffers. Besides the state
+// (NVAR3D doubles per cell), a step needs 8*NVAR3D planes of scratch, which
+// is independent of nx. Inner loops run along contiguous k and vectorise.
+//
+// opts.cfl caps dt and opts.stats is filled. The other SolverOptions must keep
+// their defaults: CT, projection, split diffusion and LTS are 2-D only.
+void solve_MHD_3d(FlowField3D& flow, double dt, double nu, const SolverOptions& opts = SolverOptions());
+double compute_cfl_timestep_3d(const FlowField3D& flow, double cfl_number = 0.2);
+// Forward-Euler limit of the explicit nu and ETA diffusion terms
+double compute_parabolic_timestep_3d(const FlowField3D& flow, double nu);
+// Max and mean |div B| from centred differences
+std::pair<double, double> compute_divergence_errors_3d(const FlowField3D& flow);
@@ -0,0 +1,241 @@
+#include "split.hpp"
+#include "riemann.hpp"
+#include "exec.hpp"
+#include <array>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+// The state seen by a sweep: the pencil direction is "n", the in-plane
+// direction across it "t". All but Q_E are reconstructed at the faces.
+enum { Q_RHO, Q_UN, Q_UT, Q_P, Q_BN, Q_BT, Q_PSI,
+#ifdef MHD_2P5D
+       Q_W, Q_BZ,
+#endif
+       Q_E, NQ };
+
+using Fields = std::array<Array2D*, NQ>;
+using Counts = std::pair<long, long>;   // nonfinite, negative
+
+// dst[j][i] = src[i][j], a tile at a time so the rows read and written stay in cache
+void transpose(const Array2D& src, Array2D& dst){
+    constexpr int T = 32;
+    const int rows = src.rows(), cols = src.cols();
+    exec::for_2d(0, (rows + T-1)/T, 0, (cols + T-1)/T, [&](int bi, int bj){
+        const int i1 = std::min(rows, (bi+1)*T), j1 = std::min(cols, (bj+1)*T);
+        for(int i = bi*T; i < i1; ++i)
+            for(int j = bj*T; j < j1; ++j) dst[j][i] = src[i][j];
+    });
+}
+
+// Advances every interior pencil of f by dt along the pencil (cell size h).
+// The pencils are the rows of the arrays, or with columns the columns, read
+// with a stride. Each pencil is copied into contiguous scratch first, with its
+// periodic ghosts taken from the other end of the pencil.
+template <class Phys, class Solver>
+Counts sweep(const Fields& f, bool columns, double dt, double h, bool use_glm){
+    const int len = columns ? f[0]->rows() : f[0]->cols();
+    const int pencils = columns ? f[0]->cols() : f[0]->rows();
+    auto at = [&](int q, int p, int k) -> double& { return columns ? (*f[q])[k][p] : (*f[q])[p][k]; };
+    auto add_counts = [](Counts a, Counts b){ return Counts{a.first + b.first, a.second + b.second}; };
+
+    // One pencil per call: the column range is a single dummy column
+    return exec::reduce_2d(1, pencils-1, 0, 1, Counts{0, 0}, add_counts, [&](int p, int){
+        thread_local std::vector<double> buf;
+        thread_local std::vector<HLLFlux> flux;
+        buf.resize((size_t)2*NQ*len);
+        flux.resize(len);
+        double* v[NQ];
+        double* s[NQ];
+        for(int q = 0; q < NQ; ++q){
+            v[q] = buf.data() + (size_t)q*len;
+            s[q] = buf.data() + (size_t)(NQ + q)*len;
+            for(int k = 1; k < len-1; ++k) v[q][k] = at(q, p, k);
+            v[q][0] = v[q][len-2];
+            v[q][len-1] = v[q][1];
+        }
+        for(int q = 0; q < Q_E; ++q){
+            #pragma omp simd
+            for(int k = 1; k < len-1; ++k) s[q][k] = minmod(v[q][k] - v[q][k-1], v[q][k+1] - v[q][k]);
+            s[q][0] = s[q][len-2];
+            s[q][len-1] = s[q][1];
+        }
+
+        // flux[k] at face k+1/2
+        for(int k = 0; k < len-1; ++k){
+            auto L = [&](int q){ return v[q][k]   + 0.5*s[q][k]; };
+            auto R = [&](int q){ return v[q][k+1] - 0.5*s[q][k+1]; };
+            flux[k] = Solver::x(L(Q_RHO), L(Q_UN), L(Q_UT), L(Q_P), L(Q_BN), L(Q_BT), L(Q_PSI),
+                                R(Q_RHO), R(Q_UN), R(Q_UT), R(Q_P), R(Q_BN), R(Q_BT), R(Q_PSI)
+#ifdef MHD_2P5D
+                                , L(Q_W), L(Q_BZ), R(Q_W), R(Q_BZ)
+#endif
+                                );
+        }
+
+        const double c = dt/h;
+        long nonfinite = 0, negative = 0;
+        for(int k = 1; k < len-1; ++k){
+            const HLLFlux& fp = flux[k];
+            const HLLFlux& fm = flux[k-1];
+            const double rho = v[Q_RHO][k];
+            double rho_n = rho - c*(fp.F_rho - fm.F_rho);
+            double mn = rho*v[Q_UN][k] - c*(fp.F_momx - fm.F_momx);
+            double mt = rho*v[Q_UT][k] - c*(fp.F_momy - fm.F_momy);
+            double e = v[Q_E][k] - c*(fp.F_E - fm.F_E);
+            double bn = v[Q_BN][k] - c*(fp.F_Bx - fm.F_Bx);
+            double bt = v[Q_BT][k] - c*(fp.F_By - fm.F_By);
+            double psi = use_glm ? v[Q_PSI][k] - c*(fp.F_psi - fm.F_psi) : v[Q_PSI][k];
+            rho_n = std::max(rho_n, 1e-10);
+            e = std::max(e, 1e-10);
+            const double un = mn/rho_n, ut = mt/rho_n;
+            double ie = e - 0.5*rho_n*(un*un + ut*ut) - 0.5*(bn*bn + bt*bt);
+#ifdef MHD_2P5D
+            const double w = (rho*v[Q_W][k] - c*(fp.F_momz - fm.F_momz))/rho_n;
+            const double bz = v[Q_BZ][k] - c*(fp.F_Bz - fm.F_Bz);
+            ie -= 0.5*rho_n*w*w + 0.5*bz*bz;
+            at(Q_W, p, k) = w;
+            at(Q_BZ, p, k) = bz;
+#endif
+            at(Q_RHO, p, k) = rho_n;
+            at(Q_UN, p, k) = un;
+            at(Q_UT, p, k) = ut;
+            at(Q_P, p, k) = (Phys::gamma - 1.0) * std::max(ie, 1e-10);
+            at(Q_BN, p, k) = bn;
+            at(Q_BT, p, k) = bt;
+            at(Q_PSI, p, k) = psi;
+            at(Q_E, p, k) = e;
+            if(!std::isfinite(ie + un + ut + psi)) ++nonfinite;
+            else if(ie < 0) ++negative;
+        }
+        return Counts{nonfinite, negative};
+    });
+}
+
+void fill_ghosts(FlowField& flow){
+    std::vector<Grid*> fields = {&flow.rho, &flow.u, &flow.v, &flow.p, &flow.e, &flow.bx, &flow.by, &flow.psi};
+#ifdef MHD_2P5D
+    fields.push_back(&flow.w);
+    fields.push_back(&flow.bz);
+#endif
+    for(Grid* g : fields){
+        exec::for_each(0, g->ny, [&](long j){
+            g->data[0][j]       = g->data[g->nx-2][j];
+            g->data[g->nx-1][j] = g->data[1][j];
+        });
+        exec::for_each(0, g->nx, [&](long i){
+            g->data[i][0]       = g->data[i][g->ny-2];
+            g->data[i][g->ny-1] = g->data[i][1];
+        });
+    }
+}
+
+template <class Phys>
+double split_update_impl(FlowField& flow, double dt, double nu, const SolverOptions& opts){
+    Grid& grid = flow.rho;
+    const int nx = grid.nx, ny = grid.ny;
+    const bool use_glm = (opts.divb == DivBScheme::GLM);
+    const bool explicit_diffusion = (opts.diffusion == DiffusionScheme::Explicit);
+    dt = std::min(dt, compute_cfl_timestep(flow, opts.cfl));
+
+    // Pencils along y are the rows; along x the same fields with the roles of
+    // the components swapped
+    const Fields along_y = {&flow.rho.data, &flow.v.data, &flow.u.data, &flow.p.data, &flow.by.data, &flow.bx.data,
+                            &flow.psi.data,
+#ifdef MHD_2P5D
+                            &flow.w.data, &flow.bz.data,
+#endif
+                            &flow.e.data};
+    const Fields along_x = {&flow.rho.data, &flow.u.data, &flow.v.data, &flow.p.data, &flow.bx.data, &flow.by.data,
+                            &flow.psi.data,
+#ifdef MHD_2P5D
+                            &flow.w.data, &flow.bz.data,
+#endif
+                            &flow.e.data};
+    Counts health{0, 0};
+    auto run = [&](const Fields& f, bool columns, double tau, double h){
+        Counts c = opts.riemann == RiemannSolver::Rusanov
+                 ? sweep<Phys, RusanovSolver<Phys>>(f, columns, tau, h, use_glm)
+                 : sweep<Phys, HLLSolver<Phys>>(f, columns, tau, h, use_glm);
+        health.first += c.first;
+        health.second += c.second;
+    };
+
+    std::vector<Array2D> t;
+    auto sweep_x = [&](double tau){
+        if(!opts.split_transpose){
+            run(along_x, true, tau, grid.dx);
+            return;
+        }
+        if(t.empty()) t.assign(NQ, Array2D(ny, nx));
+        Fields transposed;
+        for(int q = 0; q < NQ; ++q){
+            transpose(*along_x[q], t[q]);
+            transposed[q] = &t[q];
+        }
+        run(transposed, false, tau, grid.dx);
+        for(int q = 0; q < NQ; ++q) transpose(t[q], *along_x[q]);
+    };
+    // Strang: X(dt/2) Y(dt) X(dt/2)
+    sweep_x(0.5*dt);
+    run(along_y, false, dt, grid.dy);
+    sweep_x(0.5*dt);
+
+    // Explicit diffusion and the GLM source on the swept state. The total
+    // energy is kept, so the pressure takes up the dissipated energy, as in
+    // the unsplit update.
+    const bool diffuse = explicit_diffusion && (nu > 0 || Phys::eta > 0);
+    if(diffuse || use_glm){
+        const stencil::InteriorWrap P{nx, ny};
+        const Array2D u0 = flow.u.data, v0 = flow.v.data, bx0 = flow.bx.data, by0 = flow.by.data;
+#ifdef MHD_2P5D
+        const Array2D w0 = flow.w.data, bz0 = flow.bz.data;
+#endif
+        const double dx = grid.dx, dy = grid.dy;
+        exec::for_2d(1, nx-1, 1, ny-1, [&](int i, int j){
+            if(diffuse){
+                double u = u0[i][j] + dt*nu*laplacian(u0, dx, dy, i, j, P);
+                double v = v0[i][j] + dt*nu*laplacian(v0, dx, dy, i, j, P);
+                double bx = bx0[i][j] + dt*Phys::eta*laplacian(bx0, dx, dy, i, j, P);
+                double by = by0[i][j] + dt*Phys::eta*laplacian(by0, dx, dy, i, j, P);
+                const double rho = flow.rho.data[i][j];
+                double ie = flow.e.data[i][j] - 0.5*rho*(u*u + v*v) - 0.5*(bx*bx + by*by);
+#ifdef MHD_2P5D
+                double w = w0[i][j] + dt*nu*laplacian(w0, dx, dy, i, j, P);
+                double bz = bz0[i][j] + dt*Phys::eta*laplacian(bz0, dx, dy, i, j, P);
+                ie -= 0.5*rho*w*w + 0.5*bz*bz;
+                flow.w.data[i][j] = w;
+                flow.bz.data[i][j] = bz;
+#endif
+                flow.u.data[i][j] = u;
+                flow.v.data[i][j] = v;
+                flow.bx.data[i][j] = bx;
+                flow.by.data[i][j] = by;
+                flow.p.data[i][j] = (Phys::gamma - 1.0) * std::max(ie, 1e-10);
+            }
+            if(use_glm){
+                double psi = flow.psi.data[i][j];
+                double divB = stencil::divergence(bx0, by0, dx, dy, i, j, P);
+                flow.psi.data[i][j] = psi - dt*Phys::ch*Phys::ch*divB - dt*Phys::cr*psi;
+            }
+        });
+    }
+    fill_ghosts(flow);
+
+    if(opts.health){
+        opts.health->nonfinite += health.first;
+        opts.health->negative_pressure += health.second;
+    }
+    if(opts.stats) opts.stats->floored_cells += health.second;
+    return dt;
+}
+
+} // namespace
+
+double split_update(FlowField& flow, double dt, double nu, const SolverOptions& opts){
+    return dispatch_physics([&](auto phys){
+        return split_update_impl<decltype(phys)>(flow, dt, nu, opts);
+    });
+}
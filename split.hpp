@@ -0,0 +1,18 @@
+#pragma once
+#include "solver.hpp"
+
+// Strang dimensional splitting (SolverOptions::split). A step of length dt is
+// an x sweep of dt/2, a y sweep of dt and another x sweep of dt/2, so every
+// step is second-order accurate on its own, whatever dt the next one takes.
+// A sweep is a 1-D MUSCL update along pencils of cells, periodic along the
+// pencil. Each pencil is copied into contiguous scratch, so every Riemann
+// solve reads unit stride. The y pencils are the rows of the arrays. The x
+// pencils are columns, gathered with a stride, or with split_transpose rows
+// of a copy of the state transposed in cache-sized tiles. The explicit
+// diffusion terms and the GLM psi source follow the sweeps, unsplit. Not with
+// CT, LTS, the activity mask or the hybrid Riemann solver. The positivity
+// limiter does not apply: cells get the rho and pressure floors instead,
+// counted in SolverStats::floored_cells.
+
+// One split update of length dt (clamped to the CFL limit); returns the step taken
+double split_update(FlowField& flow, double dt, double nu, const SolverOptions& opts);
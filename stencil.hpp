@@ -0,0 +1,157 @@
+#pragma once
+// Compile-time stencils on Array2D/Grid. A stencil is a list of taps
+// (di, dj, integer coefficient) known at compile time, so apply() unrolls to
+// straight-line code. Index policies decide what happens at the edge of the
+// array, and the sweep helpers own the loop nest (OpenMP over rows, SIMD
+// along the contiguous j), so operators only describe the stencil itself.
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include "grid.hpp"
+#include "exec.hpp"
+
+namespace stencil {
+
+template <int DI, int DJ, int C>
+struct Tap {
+    static constexpr int di = DI, dj = DJ;
+    static constexpr double c = C;
+};
+
+// Index policies: map (i + di, j + dj) into the array
+struct Direct {
+    int i(int i, int d) const { return i + d; }
+    int j(int j, int d) const { return j + d; }
+};
+
+// Whole-array periodic wrap, ghosts included
+struct Wrap {
+    int nx, ny;
+    int i(int i, int d) const { return (i + d + nx) % nx; }
+    int j(int j, int d) const { return (j + d + ny) % ny; }
+};
+
+// Periodic over the interior 1..n-2, ghosts skipped (|d| <= 1)
+struct InteriorWrap {
+    int nx, ny;
+    int i(int i, int d) const { return d > 0 && i == nx-2 ? 1 : d < 0 && i == 1 ? nx-2 : i + d; }
+    int j(int j, int d) const { return d > 0 && j == ny-2 ? 1 : d < 0 && j == 1 ? ny-2 : j + d; }
+};
+
+// Sum of c * a[i+di][j+dj], evaluated left to right in tap order
+template <class... Taps>
+struct Stencil {
+    static constexpr int radius = std::max({0, std::abs(Taps::di)..., std::abs(Taps::dj)...});
+
+    template <class Idx = Direct>
+    static inline double apply(const Array2D& a, int i, int j, const Idx& idx = Idx()) {
+        return (... + (Taps::c * a[idx.i(i, Taps::di)][idx.j(j, Taps::dj)]));
+    }
+};
+
+enum Axis { X, Y };
+
+template <Axis A, int D, int C>
+using AxisTap = Tap<A == X ? D : 0, A == Y ? D : 0, C>;
+
+// Second difference, centred difference, and one-sided differences along an axis
+template <Axis A> using D2       = Stencil<AxisTap<A, 1, 1>, AxisTap<A, 0, -2>, AxisTap<A, -1, 1>>;
+template <Axis A> using Centred  = Stencil<AxisTap<A, 1, 1>, AxisTap<A, -1, -1>>;
+template <Axis A> using Backward = Stencil<AxisTap<A, 0, 1>, AxisTap<A, -1, -1>>;
+template <Axis A> using Forward  = Stencil<AxisTap<A, 1, 1>, AxisTap<A, 0, -1>>;
+
+// Minmod slope limiter
+static inline double minmod(double a, double b){
+    if(a*b <= 0.0) return 0.0;
+    return (std::abs(a) < std::abs(b)) ? a : b;
+}
+
+// ---- Operators -------------------------------------------------------------
+
+template <class Idx = Direct>
+static inline double laplacian(const Array2D& a, double dx, double dy, int i, int j, const Idx& idx = Idx()) {
+    return D2<X>::apply(a, i, j, idx)/(dx*dx) + D2<Y>::apply(a, i, j, idx)/(dy*dy);
+}
+
+template <class Idx = Direct>
+static inline double laplacian(const Grid& g, int i, int j, const Idx& idx = Idx()) {
+    return laplacian(g.data, g.dx, g.dy, i, j, idx);
+}
+
+// Centred first derivative along an axis
+template <Axis A, class Idx = Direct>
+static inline double ddx(const Array2D& a, double h, int i, int j, const Idx& idx = Idx()) {
+    return Centred<A>::apply(a, i, j, idx) / (2*h);
+}
+
+// Centred divergence of (ax, ay)
+template <class Idx = Direct>
+static inline double divergence(const Array2D& ax, const Array2D& ay, double dx, double dy,
+                                int i, int j, const Idx& idx = Idx()) {
+    return ddx<X>(ax, dx, i, j, idx) + ddx<Y>(ay, dy, i, j, idx);
+}
+
+// Centred z-component of the curl of (ax, ay): d(ay)/dx - d(ax)/dy. Gives the
+// current density Jz from (bx, by) and the vorticity from (u, v).
+template <class Idx = Direct>
+static inline double curl_z(const Array2D& ax, const Array2D& ay, double dx, double dy,
+                            int i, int j, const Idx& idx = Idx()) {
+    return ddx<X>(ay, dx, i, j, idx) - ddx<Y>(ax, dy, i, j, idx);
+}
+
+// Minmod-limited slope along an axis
+template <Axis A, class Idx = Direct>
+static inline double limited_slope(const Array2D& a, int i, int j, const Idx& idx = Idx()) {
+    return minmod(Backward<A>::apply(a, i, j, idx), Forward<A>::apply(a, i, j, idx));
+}
+
+// ---- Sweeps ----------------------------------------------------------------
+
+// body(i, j) for i in [i0, i1), j in [j0, j1): rows in parallel, j vectorised
+template <class Body>
+inline void sweep(int i0, int i1, int j0, int j1, Body&& body) {
+    exec::for_each(i0, i1, [&](long i){
+        #pragma omp simd
+        for (int j = j0; j < j1; ++j) body((int)i, j);
+    });
+}
+
+// body(i, j, idx) over the whole nx x ny array for a stencil of radius r:
+// the block at least r cells from every edge gets Direct indexing, the ring
+// around it the periodic Wrap policy
+template <class Body>
+inline void sweep_periodic(int nx, int ny, int r, Body&& body) {
+    const Wrap wrap{nx, ny};
+    sweep(r, nx-r, r, ny-r, [&](int i, int j){ body(i, j, Direct()); });
+    exec::for_each(0, nx, [&](long i){
+        const bool edge_row = i < r || i >= nx-r;
+        for (int j = 0; j < ny; ++j)
+            if (edge_row || j < r || j >= ny-r) body((int)i, j, wrap);
+    });
+}
+
+// Minmod slopes of g along A into s for every cell with both neighbours along
+// A. nx and ny may be passed as compile-time constants of the caller.
+template <Axis A>
+inline void limited_slopes(const Grid& g, Array2D& s, int nx, int ny) {
+    const int i0 = A == X ? 1 : 0, j0 = A == Y ? 1 : 0;
+    sweep(i0, nx - i0, j0, ny - j0, [&](int i, int j){
+        s[i][j] = limited_slope<A>(g.data, i, j);
+    });
+}
+
+template <Axis A>
+inline void limited_slopes(const Grid& g, Array2D& s) { limited_slopes<A>(g, s, g.nx, g.ny); }
+
+// Max and sum of |f(i, j)| over [i0, i1) x [j0, j1)
+template <class F>
+inline std::pair<double, double> abs_max_sum(int i0, int i1, int j0, int j1, F&& f) {
+    using MaxSum = std::pair<double, double>;
+    auto combine = [](MaxSum a, MaxSum b){ return MaxSum{std::max(a.first, b.first), a.second + b.second}; };
+    return exec::reduce_2d(i0, i1, j0, j1, MaxSum{0.0, 0.0}, combine, [&](int i, int j){
+        double a = std::abs(f(i, j));
+        return MaxSum{a, a};
+    });
+}
+
+} // namespace stencil
@@ -0,0 +1,169 @@
+#include "tracers.hpp"
+#include "exec.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+
+// Bilinear velocity lookup and periodic wrapping on the cell-centred grid
+struct Sampler {
+    const double* u;
+    const double* v;
+    int nx, ny;
+    double x0, y0, idx, idy;
+    double xlo, ylo, Lx, Ly;   // periodic interior [xlo, xlo+Lx) x [ylo, ylo+Ly)
+
+    explicit Sampler(const FlowField& f)
+        : u(f.u.data.ptr()), v(f.v.data.ptr()), nx(f.u.nx), ny(f.u.ny),
+          x0(f.u.x0), y0(f.u.y0), idx(1.0/f.u.dx), idy(1.0/f.u.dy),
+          xlo(f.u.x0 + f.u.dx), ylo(f.u.y0 + f.u.dy), Lx((f.u.nx-2)*f.u.dx), Ly((f.u.ny-2)*f.u.dy) {}
+
+    double wrap_x(double x) const { return x - Lx*std::floor((x - xlo)/Lx); }
+    double wrap_y(double y) const { return y - Ly*std::floor((y - ylo)/Ly); }
+
+    // Cell (i, j) at the lower-left of the interpolation stencil; the upper
+    // neighbours may be ghosts, which hold the periodic copies
+    int cell_i(double x) const { return std::min(std::max((int)((x - x0)*idx), 1), nx-2); }
+    int cell_j(double y) const { return std::min(std::max((int)((y - y0)*idy), 1), ny-2); }
+
+    void sample(double x, double y, double& ux, double& uy) const {
+        const int i = cell_i(x), j = cell_j(y);
+        const double tx = (x - x0)*idx - i, ty = (y - y0)*idy - j;
+        const size_t c = (size_t)i*ny + j;
+        const double w00 = (1-tx)*(1-ty), w01 = (1-tx)*ty, w10 = tx*(1-ty), w11 = tx*ty;
+        ux = w00*u[c] + w01*u[c+1] + w10*u[c+ny] + w11*u[c+ny+1];
+        uy = w00*v[c] + w01*v[c+1] + w10*v[c+ny] + w11*v[c+ny+1];
+    }
+};
+
+} // namespace
+
+Tracers::Tracers(const FlowField& flow, long count, unsigned seed){
+    const Sampler s(flow);
+    x_.resize(count); y_.resize(count); kx_.resize(count); ky_.resize(count); id_.resize(count);
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> ux(0.0, s.Lx), uy(0.0, s.Ly);
+    for(long k = 0; k < count; ++k){
+        x_[k] = s.wrap_x(s.xlo + ux(rng));
+        y_[k] = s.wrap_y(s.ylo + uy(rng));
+        id_[k] = (std::uint32_t)k;
+    }
+}
+
+void Tracers::predict(const FlowField& flow, double dt){
+    const Sampler s(flow);
+    double* x = x_.data(); double* y = y_.data();
+    double* kx = kx_.data(); double* ky = ky_.data();
+    const long n = (long)x_.size();
+    exec::for_blocks(0, n, [&](long b, long e){
+        #pragma omp simd
+        for(long k = b; k < e; ++k){
+            double ux, uy;
+            s.sample(x[k], y[k], ux, uy);
+            kx[k] = ux; ky[k] = uy;
+            x[k] = s.wrap_x(x[k] + dt*ux);
+            y[k] = s.wrap_y(y[k] + dt*uy);
+        }
+    });
+}
+
+void Tracers::correct(const FlowField& flow, double dt){
+    // x(t+dt) = x(t) + dt/2 (k1 + k2) = predicted + dt/2 (k2 - k1)
+    const Sampler s(flow);
+    double* x = x_.data(); double* y = y_.data();
+    const double* kx = kx_.data(); const double* ky = ky_.data();
+    const long n = (long)x_.size();
+    exec::for_blocks(0, n, [&](long b, long e){
+        #pragma omp simd
+        for(long k = b; k < e; ++k){
+            double ux, uy;
+            s.sample(x[k], y[k], ux, uy);
+            x[k] = s.wrap_x(x[k] + 0.5*dt*(ux - kx[k]));
+            y[k] = s.wrap_y(y[k] + 0.5*dt*(uy - ky[k]));
+        }
+    });
+}
+
+void Tracers::sort(const FlowField& flow){
+    const Sampler s(flow);
+    const size_t n = x_.size(), ncells = (size_t)s.nx * s.ny;
+    cell_.resize(n);
+    exec::for_blocks(0, (long)n, [&](long b, long e){
+        #pragma omp simd
+        for(long k = b; k < e; ++k)
+            cell_[k] = (std::uint32_t)(s.cell_i(x_[k])*s.ny + s.cell_j(y_[k]));
+    });
+
+    // Counting sort: stable, two passes over the particles
+    start_.assign(ncells + 1, 0);
+    for(size_t k = 0; k < n; ++k) ++start_[cell_[k] + 1];
+    for(size_t c = 0; c < ncells; ++c) start_[c + 1] += start_[c];
+    sx_.resize(n); sy_.resize(n); sid_.resize(n);
+    for(size_t k = 0; k < n; ++k){
+        const std::uint32_t to = start_[cell_[k]]++;
+        sx_[to] = x_[k]; sy_[to] = y_[k]; sid_[to] = id_[k];
+    }
+    x_.swap(sx_); y_.swap(sy_); id_.swap(sid_);
+}
+
+// ---- Trajectories ----------------------------------------------------------
+
+TrajectoryWriter::TrajectoryWriter(const std::string& dir, size_t count)
+    : frame_(2*count)
+{
+    std::filesystem::create_directories(dir);
+    const std::string path = dir + "/tracers.bin";
+    file_ = std::fopen(path.c_str(), "wb");
+    if(!file_) throw std::runtime_error("tracers: cannot create '" + path + "'");
+    char header[24];
+    const std::uint32_t version = 1, reserved = 0;
+    const std::uint64_t n = count;
+    std::memcpy(header, "MHDTRAC1", 8);
+    std::memcpy(header + 8, &version, 4);
+    std::memcpy(header + 12, &reserved, 4);
+    std::memcpy(header + 16, &n, 8);
+    if(std::fwrite(header, 1, sizeof(header), file_) != sizeof(header) || std::fflush(file_) != 0)
+        throw std::runtime_error("tracers: cannot write '" + path + "'");
+}
+
+TrajectoryWriter::~TrajectoryWriter(){
+    if(file_) std::fclose(file_);
+}
+
+void TrajectoryWriter::append(const Tracers& tracers, long step, double time){
+    const size_t n = frame_.size() / 2;
+    if(tracers.size() != n)
+        throw std::invalid_argument("tracers: trajectory file holds " + std::to_string(n) + " particles");
+    const double* x = tracers.x();
+    const double* y = tracers.y();
+    const std::uint32_t* id = tracers.id();
+    float* fx = frame_.data();
+    float* fy = frame_.data() + n;
+    exec::for_each(0, (long)n, [&](long k){
+        fx[id[k]] = (float)x[k];
+        fy[id[k]] = (float)y[k];
+    });
+    char head[16];
+    const std::int64_t s = step;
+    std::memcpy(head, &s, 8);
+    std::memcpy(head + 8, &time, 8);
+    if(std::fwrite(head, 1, sizeof(head), file_) != sizeof(head) ||
+       std::fwrite(frame_.data(), sizeof(float), frame_.size(), file_) != frame_.size() ||
+       std::fflush(file_) != 0)
+        throw std::runtime_error("tracers: trajectory write failed at step " + std::to_string(step));
+    ++frames_;
+}
+
+void TrajectoryWriter::truncate(long frames){
+    if(frames >= frames_) return;
+    const long frame_bytes = 16 + (long)(frame_.size() * sizeof(float));
+    std::fflush(file_);
+    if(ftruncate(fileno(file_), (off_t)(24 + frames*frame_bytes)) != 0 || std::fseek(file_, 0, SEEK_END) != 0)
+        throw std::runtime_error("tracers: cannot truncate the trajectory file to " + std::to_string(frames) + " frames");
+    frames_ = frames;
+}
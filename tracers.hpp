@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "grid.hpp"
+
+// Massless tracer particles advected with the velocity (u, v) of a 2-D
+// FlowField, bilinearly interpolated between cell centres. Positions live in
+// the periodic interior: cell i sits at x0 + i*dx and the period is
+// (nx-2)*dx, as in the solver's ghost exchange.
+//
+// The push is Heun's method across a solver step: predict() before
+// solve_MHD takes an Euler step with the velocity at t, and correct()
+// after it averages that with the velocity at t+dt at the predicted point.
+// Both loops are OpenMP-parallel and SIMD. Particles are stored as separate
+// arrays (x, y, id), and sort() reorders them by cell with a counting sort,
+// so the velocity gathers of a push walk the grid in order.
+class Tracers {
+public:
+    // count particles placed uniformly at random over the periodic interior,
+    // in random order until the first sort()
+    Tracers(const FlowField& flow, long count, unsigned seed = 12345);
+
+    void predict(const FlowField& flow, double dt);
+    void correct(const FlowField& flow, double dt);
+    void sort(const FlowField& flow);
+
+    size_t size() const { return x_.size(); }
+    // Positions in storage order; id()[k] is the particle at slot k
+    const double* x() const { return x_.data(); }
+    const double* y() const { return y_.data(); }
+    const std::uint32_t* id() const { return id_.data(); }
+
+private:
+    template <class T> using Buffer = std::vector<T, HugePageAllocator<T>>;
+    Buffer<double> x_, y_, kx_, ky_;   // kx_, ky_: velocity of the predictor stage
+    Buffer<std::uint32_t> id_;
+    Buffer<double> sx_, sy_;           // sort scratch
+    Buffer<std::uint32_t> sid_, cell_;
+    std::vector<std::uint32_t> start_;
+};
+
+// Trajectory file <dir>/tracers.bin (native little-endian):
+//   header  "MHDTRAC1", u32 version (1), u32 reserved, u64 count
+//   frame   i64 step, f64 time, f32 x[count], f32 y[count], indexed by particle id
+// Frames have a fixed size, so frame k starts at 24 + k*(16 + 8*count); a
+// torn last frame is ignored by readers. snapshots.read_tracers() loads it.
+class TrajectoryWriter {
+public:
+    // Throws std::runtime_error if the file cannot be created
+    TrajectoryWriter(const std::string& dir, size_t count);
+    ~TrajectoryWriter();
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    void append(const Tracers& tracers, long step, double time);
+    // Drops the frames after the first `frames` (a rolled-back run rewriting steps)
+    void truncate(long frames);
+    long frames() const { return frames_; }
+
+private:
+    std::FILE* file_ = nullptr;
+    std::vector<float> frame_;
+    long frames_ = 0;
+};